@@ -0,0 +1,120 @@
+#include "batch.hpp"
+#include "workqueue.hpp"
+
+#include <string>
+#include <map>
+#include <atomic>
+#include <algorithm>
+
+/// a line of the input, numbered from 1
+struct batchJob
+{
+    size_t id;
+    std::string line;
+};
+
+static std::string solveLine(const BatchSolver &solver, const std::string &line, bool &solved)
+{
+    std::string result;
+    solved = false;
+
+    pyramid p(RED, RED, RED, RED);
+    ParseError parsed = parsePyramid(line, p);
+
+    if(parsed != PARSE_OK)
+        return std::string("error: ") + parseErrorToString(parsed);
+
+    try
+    {
+        std::list<Operation> moves;
+
+        if(!solver(p, moves))
+            return "error: the pyramid cannot be solved";
+
+        for(Operation op: moves)
+        {
+            if(!result.empty())
+                result += ' ';
+
+            result += std::to_string(op);
+        }
+
+        solved = true;
+    }
+    catch(const std::exception &e)
+    {
+        result = std::string("error: ") + e.what();
+    }
+
+    return result;
+}
+
+size_t solveBatch(std::istream &in, std::ostream &out, const BatchSolver &solver, unsigned int threads, size_t capacity)
+{
+    threads = std::max(threads, 1u);
+    capacity = std::max<size_t>(capacity, 1);
+
+    WorkQueue<batchJob> jobs(capacity);
+
+    // results that are done but still wait for an earlier one, by id. A job is only taken once its id is less than
+    // written + capacity, so this never holds more than capacity results.
+    std::map<size_t, std::string> done;
+    size_t written = 0;             // the number of results that were written to out
+    std::mutex mutex;
+    std::condition_variable progress;
+    std::atomic<size_t> solved(0);
+
+    auto work = [&]()
+    {
+        batchJob job;
+
+        while(jobs.pop(job))
+        {
+            bool ok;
+            std::string result = solveLine(solver, job.line, ok);
+            solved += ok;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            progress.wait(lock, [&]{ return job.id <= written + capacity; });
+
+            done.emplace(job.id, std::to_string(job.id) + '\t' + result);
+
+            // write everything that is in order now. The thread that finishes the next result does the writing.
+            for(auto it = done.begin(); it != done.end() && it->first == written + 1; it = done.erase(it))
+            {
+                out << it->second << '\n';
+                written++;
+            }
+
+            progress.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for(unsigned int t=0; t<threads; t++)
+        workers.emplace_back(work);
+
+    std::string line;
+    size_t id = 0;
+
+    while(std::getline(in, line))
+    {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if(line.empty())
+            continue;
+
+        jobs.push({++id, line});
+    }
+
+    jobs.close();
+
+    for(std::thread &w: workers)
+        w.join();
+
+    out.flush();
+
+    return solved;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "pyramid.hpp"
+
+#include <iostream>
+#include <functional>
+#include <list>
+#include <thread>
+
+/// solves one pyramid into moves, returns false if it cannot be solved. Must be safe to call from several threads at once.
+typedef std::function<bool(const pyramid &p, std::list<Operation> &moves)> BatchSolver;
+
+/**
+ * Solves the pyramids in, one storage string per line, on the given number of threads, and writes one line per pyramid to out,
+ * in the order of the input. Each line is the number of the pyramid in the input (starting at 1), a tab, and either the numbers of
+ * the operations of the solution separated by spaces (none if it is solved already), or "error: " followed by the reason why there is none. Empty lines are skipped.
+ * At most capacity lines are in flight at any time, so reading waits for the solvers, and the solvers wait for the output.
+ * Returns the number of pyramids that were solved.
+ */
+size_t solveBatch(std::istream &in, std::ostream &out, const BatchSolver &solver,
+                  unsigned int threads = std::thread::hardware_concurrency(), size_t capacity = 1024);
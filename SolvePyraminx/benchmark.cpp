@@ -0,0 +1,241 @@
+#include "benchmark.hpp"
+#include "pyramid.hpp"
+#include "distancetable.hpp"
+#include "coordinates.hpp"
+#include "pyramidbatch.hpp"
+#include "permutation.hpp"
+#include "surfacekernels.hpp"
+
+#include <chrono>
+#include <algorithm>
+
+/// results are added up here, so that the compiler cannot drop the calls that compute them
+static volatile size_t benchmarkSink;
+
+static void consume(size_t x)
+{
+    benchmarkSink = benchmarkSink + x;
+}
+
+/// the number of scrambles in the corpus
+static const size_t CORPUS_SIZE = 64;
+
+/// a fixed set of scrambled pyramids, with twisted tips, spread over the whole state space
+static std::vector<pyramid> scrambleCorpus()
+{
+    std::vector<pyramid> corpus;
+
+    for(size_t i=0; i<CORPUS_SIZE; i++)
+    {
+        pyramid p = pyramid::unrank((i * 104729 + 1) % PYRAMID_STATES);
+
+        apply<OP_TOP_RIGHT, OP_LEFTEST_DOWN>(p);
+        corpus.push_back(p);
+    }
+
+    return corpus;
+}
+
+/// calls f(i) for i = 0, 1, ... in rounds of growing size, until a round takes at least minSeconds.
+/// F is the type of the lambda itself, so that its body is inlined into the loop instead of called through a std::function.
+template<typename F>
+static BenchmarkResult measure(const std::string &name, const F &f, double minSeconds)
+{
+    // warm up the caches, and build the tables that are built on first use
+    f(0);
+
+    size_t n = 1;
+
+    while(true)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for(size_t i=0; i<n; i++)
+            f(i);
+
+        double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if(time >= minSeconds)
+            return {name, n, time * 1e9 / n};
+
+        // aim a bit beyond minSeconds, but grow at most 100 times per round
+        n = time > 0 ? std::min<size_t>(n * 100, n * 1.2 * minSeconds / time + 1) : n * 100;
+    }
+}
+
+std::vector<BenchmarkResult> runBenchmarks(double minSeconds)
+{
+    std::vector<BenchmarkResult> results;
+
+    const std::vector<pyramid> corpus = scrambleCorpus();
+
+    std::vector<std::string> encodings;
+
+    for(const pyramid &p: corpus)
+        encodings.push_back(p.storageString());
+
+    for(Operation op: allOperations)
+    {
+        pyramid p = corpus.front();
+
+        results.push_back(measure("executeOperation/" + std::to_string(op), [&](size_t)
+        {
+            executeOperation(p, op);
+        }, minSeconds));
+
+        consume(p.rank());
+    }
+
+    surface s = corpus.front().getFront();
+
+    results.push_back(measure("surface::rotateClockwise", [&](size_t){ s.rotateClockwise(); }, minSeconds));
+    consume(s.computeHash());
+
+    const char *surfaceKernelNames[SURFACE_KERNEL_COUNT] = {"portable", "bmi2", "shuffle"};
+
+    for(int kernel=SURFACE_KERNEL_PORTABLE; kernel<SURFACE_KERNEL_COUNT; kernel++)
+    {
+        if(!surfaceKernelSupported(SurfaceKernel(kernel)))
+            continue;
+
+        unsigned int x = s.getColors();
+
+        results.push_back(measure(std::string("permuteSurface/") + surfaceKernelNames[kernel], [&](size_t i)
+        {
+            x = permuteSurface(x, SurfacePermutation(i % SURFACE_PERMUTATION_COUNT), SurfaceKernel(kernel));
+        }, minSeconds));
+
+        consume(x);
+    }
+
+    results.push_back(measure("hashPyramid", [&](size_t i)
+    {
+        consume(hashPyramid()(corpus[i % CORPUS_SIZE]));
+    }, minSeconds));
+
+    results.push_back(measure("pyramid::equivalent", [&](size_t i)
+    {
+        consume(corpus[i % CORPUS_SIZE].equivalent(corpus[(i + 1) % CORPUS_SIZE]));
+    }, minSeconds));
+
+    results.push_back(measure("parsePyramid", [&](size_t i)
+    {
+        pyramid p(RED, RED, RED, RED);
+        consume(parsePyramid(encodings[i % CORPUS_SIZE], p));
+    }, minSeconds));
+
+    results.push_back(measure("pyramid::storageString", [&](size_t i)
+    {
+        consume(corpus[i % CORPUS_SIZE].storageString().size());
+    }, minSeconds));
+
+    results.push_back(measure("pyramid::rank", [&](size_t i)
+    {
+        consume(corpus[i % CORPUS_SIZE].rank());
+    }, minSeconds));
+
+    // the time per pyramid, so that it compares to executeOperation()
+    PyramidBatch batch;
+
+    for(const pyramid &p: corpus)
+        batch.push_back(p);
+
+    BenchmarkResult batchResult = measure("PyramidBatch::apply", [&](size_t i)
+    {
+        batch.apply(Operation(OP_UPPER_RIGHT + i % 8));
+    }, minSeconds);
+
+    batchResult.nanoseconds /= CORPUS_SIZE;
+    results.push_back(batchResult);
+
+    consume(batch.at(0).rank());
+
+    const CoordinateMoves &coordinateMoves = CoordinateMoves::shared();
+    CoordinatePyramid c(corpus.front());
+
+    results.push_back(measure("CoordinateMoves::apply", [&](size_t i)
+    {
+        c = coordinateMoves.apply(c, Operation(OP_UPPER_RIGHT + i % 8));
+    }, minSeconds));
+
+    consume(c.rank());
+
+    // a sequence as long as the longest solutions, one operation after the other and fused
+    const std::list<Operation> sequence = {
+        OP_UPPER_RIGHT, OP_RIGHT_UP, OP_LEFT_DOWN, OP_BACK_CLOCKWISE, OP_UPPER_LEFT, OP_RIGHT_DOWN,
+        OP_LEFT_UP, OP_BACK_COUNTER_CLOCKWISE, OP_UPPER_RIGHT, OP_RIGHT_UP, OP_LEFT_UP
+    };
+
+    results.push_back(measure("executeOperation/sequence", [&](size_t i)
+    {
+        pyramid p(corpus[i % CORPUS_SIZE]);
+
+        for(Operation op: sequence)
+            executeOperation(p, op);
+
+        consume(p.getFront().getColors());
+    }, minSeconds));
+
+    results.push_back(measure("MacroOperation::MacroOperation", [&](size_t)
+    {
+        consume(MacroOperation(sequence).getPermutation().target[0]);
+    }, minSeconds));
+
+    const MacroOperation macro(sequence);
+
+    results.push_back(measure("MacroOperation::apply", [&](size_t i)
+    {
+        pyramid p(corpus[i % CORPUS_SIZE]);
+        macro.apply(p);
+        consume(p.getFront().getColors());
+    }, minSeconds));
+
+    const DistanceTable table;
+
+    results.push_back(measure("DistanceTable::solve", [&](size_t i)
+    {
+        std::list<Operation> moves;
+        consume(table.solve(corpus[i % CORPUS_SIZE], moves));
+    }, minSeconds));
+
+    const std::pair<SolveMode, std::string> modes[] = {
+        {SOLVE_BFS, "bfs"},
+        {SOLVE_BIDIRECTIONAL, "bidirectional"},
+        {SOLVE_IDA_STAR, "ida*"}
+    };
+
+    for(auto &[mode, name]: modes)
+    {
+        results.push_back(measure("solve/" + name, [&](size_t i)
+        {
+            pyramid p(corpus[i % CORPUS_SIZE]);
+            std::list<Operation> moves;
+            consume(solve(p, moves, mode));
+        }, minSeconds));
+    }
+
+    return results;
+}
+
+void writeBenchmarks(std::ostream &out, const std::vector<BenchmarkResult> &results, bool json)
+{
+    if(json)
+    {
+        out << "[" << std::endl;
+
+        for(size_t i=0; i<results.size(); i++)
+        {
+            out << "  {\"name\": \"" << results[i].name << "\", \"iterations\": " << results[i].iterations
+                << ", \"ns_per_op\": " << results[i].nanoseconds << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+        }
+
+        out << "]" << std::endl;
+    }
+    else
+    {
+        out << "name,iterations,ns_per_op" << std::endl;
+
+        for(const BenchmarkResult &r: results)
+            out << r.name << "," << r.iterations << "," << r.nanoseconds << std::endl;
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/// the time per call of one benchmark
+struct BenchmarkResult
+{
+    std::string name;
+    size_t iterations;
+    double nanoseconds;     // per call
+};
+
+/**
+ * Measures the hot paths: every Operation through executeOperation() and per pyramid in a PyramidBatch, surface rotations, hashing, equivalence,
+ * parsing, storageString(), ranking, coordinate moves, and solving a fixed corpus of scrambles with every solver.
+ * Each benchmark is repeated until it ran for at least minSeconds.
+ */
+std::vector<BenchmarkResult> runBenchmarks(double minSeconds = 0.2);
+
+/// writes the results as CSV with a header line, or as a JSON array of objects if json is true
+void writeBenchmarks(std::ostream &out, const std::vector<BenchmarkResult> &results, bool json);
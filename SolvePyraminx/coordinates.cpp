@@ -0,0 +1,69 @@
+#include "coordinates.hpp"
+
+CoordinatePyramid::CoordinatePyramid(const pyramid &p)
+{
+    const size_t r = p.rank();
+
+    edges = r / 81;
+    centers = r % 81;
+    tips = p.tipTwists();
+}
+
+pyramid CoordinatePyramid::toPyramid() const
+{
+    pyramid p = pyramid::unrank(rank());
+
+    // twist tip c back from its aligned position by as many steps as tipMoves[c] would need to align it
+    int twists = tips;
+
+    for(int c=3; c>=0; c--, twists /= 3)
+    {
+        for(int t=0; t<twists % 3; t++)
+            executeOperation(p, reverseOp(tipMoves[c]));
+    }
+
+    return p;
+}
+
+CoordinateMoves::CoordinateMoves() : edgeMoves(EDGE_COORDINATES * OPERATION_COUNT),
+                                     centerMoves(TWIST_COORDINATES * OPERATION_COUNT), tipMoves(TWIST_COORDINATES * OPERATION_COUNT)
+{
+    // a coordinate does not depend on the others, so it is enough to move a pyramid where the others are 0
+    for(size_t e=0; e<EDGE_COORDINATES; e++)
+    {
+        const pyramid p = CoordinatePyramid(e, 0, 0).toPyramid();
+
+        for(int op=0; op<OPERATION_COUNT; op++)
+        {
+            pyramid pp(p);
+            executeOperation(pp, Operation(op));
+
+            edgeMoves[e * OPERATION_COUNT + op] = pp.rank() / 81;
+        }
+    }
+
+    for(size_t t=0; t<TWIST_COORDINATES; t++)
+    {
+        const pyramid centersTwisted = CoordinatePyramid(0, t, 0).toPyramid();
+        const pyramid tipsTwisted = CoordinatePyramid(0, 0, t).toPyramid();
+
+        for(int op=0; op<OPERATION_COUNT; op++)
+        {
+            pyramid pp(centersTwisted);
+            executeOperation(pp, Operation(op));
+
+            centerMoves[t * OPERATION_COUNT + op] = pp.rank() % 81;
+
+            pp = tipsTwisted;
+            executeOperation(pp, Operation(op));
+
+            tipMoves[t * OPERATION_COUNT + op] = pp.tipTwists();
+        }
+    }
+}
+
+const CoordinateMoves &CoordinateMoves::shared()
+{
+    static const CoordinateMoves moves;
+    return moves;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "pyramid.hpp"
+
+#include <vector>
+#include <cstdint>
+
+/// the number of values of the edge coordinate: 360 even permutations of the 6 edges times 32 orientations
+const size_t EDGE_COORDINATES = PYRAMID_STATES / 81;
+
+/// the number of values of the center and of the tip coordinate: 3 twists for each of 4 pieces
+const size_t TWIST_COORDINATES = 81;
+
+/**
+ * A pyramid described by its pieces instead of its tiles: the permutation and orientation of the 6 edges,
+ * and the twists of the 4 axial centers and of the 4 tips, each one packed into a number.
+ * These are the parts of pyramid::rank() (edges * 81 + centers) and pyramid::tipTwists(), so all of them are 0 when it is solved.
+ * Every operation changes each coordinate on its own, so moves are lookups in the tables of CoordinateMoves.
+ */
+struct CoordinatePyramid
+{
+    uint16_t edges;
+    uint8_t centers;
+    uint8_t tips;
+
+    /// the solved pyramid
+    CoordinatePyramid() : edges(0), centers(0), tips(0)
+    {
+
+    }
+
+    CoordinatePyramid(uint16_t edges, uint8_t centers, uint8_t tips) : edges(edges), centers(centers), tips(tips)
+    {
+
+    }
+
+    /// the coordinates of p, which must be a valid configuration
+    explicit CoordinatePyramid(const pyramid &p);
+
+    /// the pyramid with these coordinates, in the colors of pyramid::unrank()
+    pyramid toPyramid() const;
+
+    /// the rank of the pyramid without its tips, see pyramid::rank()
+    size_t rank() const
+    {
+        return size_t(edges) * 81 + centers;
+    }
+
+    bool isSolved() const
+    {
+        return edges == 0 && centers == 0 && tips == 0;
+    }
+
+    bool operator==(const CoordinatePyramid &c) const = default;
+};
+
+/**
+ * The move tables of the coordinates: the result of every Operation on every value of each coordinate.
+ * They are built from the facelet model once, and take about 540 KB.
+ */
+class CoordinateMoves
+{
+    public:
+
+    CoordinateMoves();
+
+    /// the tables shared by all users, built on first use
+    static const CoordinateMoves &shared();
+
+    CoordinatePyramid apply(const CoordinatePyramid &c, Operation op) const
+    {
+        return {edgeMoves[c.edges * OPERATION_COUNT + op], centerMoves[c.centers * OPERATION_COUNT + op], tipMoves[c.tips * OPERATION_COUNT + op]};
+    }
+
+    uint16_t moveEdges(uint16_t edges, Operation op) const
+    {
+        return edgeMoves[edges * OPERATION_COUNT + op];
+    }
+
+    uint8_t moveCenters(uint8_t centers, Operation op) const
+    {
+        return centerMoves[centers * OPERATION_COUNT + op];
+    }
+
+    private:
+
+    /// OPERATION_COUNT entries for each value of the coordinate
+    std::vector<uint16_t> edgeMoves;
+
+    std::vector<uint8_t> centerMoves;
+
+    std::vector<uint8_t> tipMoves;
+};
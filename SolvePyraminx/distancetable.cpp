@@ -0,0 +1,124 @@
+#include "distancetable.hpp"
+#include "graph.hpp"
+#include "permutation.hpp"
+#include "tablefile.hpp"
+
+#include <stdexcept>
+#include <cstring>
+
+DistanceTable::DistanceTable() : entries((PYRAMID_STATES + 3) / 4, 0xff), depth(0)
+{
+    // breadth-first search, one layer of equal distance after the other
+    const ImplicitGraph graph;
+    std::vector<uint32_t> layer = {0};      // rank 0 is the solved pyramid
+    set(0, 0);
+
+    while(!layer.empty())
+    {
+        std::vector<uint32_t> next;
+
+        for(uint32_t r: layer)
+        {
+            for(Edge e: graph.neighbors(r))
+            {
+                size_t rr = edgeTarget(e);
+
+                if(get(rr) == UNKNOWN)
+                {
+                    set(rr, (depth + 1) % 3);
+                    next.push_back(rr);
+                }
+            }
+        }
+
+        if(!next.empty())
+            depth++;
+
+        layer.swap(next);
+    }
+}
+
+DistanceTable::DistanceTable(const std::string &filename) : entries((PYRAMID_STATES + 3) / 4)
+{
+    // the table is small, so the checksum costs next to nothing
+    const MappedTable table(filename, TABLE_DISTANCES, 1, true);
+
+    if(table.size() != entries.size() + 1)
+        throw std::runtime_error("DistanceTable: " + filename + " holds " + std::to_string(table.size()) + " records, expected "
+                                 + std::to_string(entries.size() + 1));
+
+    const uint8_t *records = table.records<uint8_t>();
+
+    std::memcpy(entries.data(), records, entries.size());
+    depth = records[entries.size()];
+}
+
+void DistanceTable::save(const std::string &filename) const
+{
+    std::vector<uint8_t> records(entries);
+    records.push_back(depth);
+
+    writeTable(filename, TABLE_DISTANCES, records.data(), 1, records.size());
+}
+
+int DistanceTable::get(size_t r) const
+{
+    return (entries[r / 4] >> 2*(r % 4)) & 0b11;
+}
+
+void DistanceTable::set(size_t r, int d)
+{
+    uint8_t &e = entries[r / 4];
+    e &= ~(0b11 << 2*(r % 4));
+    e |= d << 2*(r % 4);
+}
+
+int DistanceTable::maxDistance() const
+{
+    return depth;
+}
+
+bool DistanceTable::solve(const pyramid &start, std::list<Operation> &moves) const
+{
+    pyramid p(start);
+    size_t r = p.rank();
+
+    if(r >= PYRAMID_STATES || get(r) == UNKNOWN)
+        return false;
+
+    std::list<Operation> solution;
+
+    // every step finds a neighbor one move closer, so this takes at most maxDistance() steps
+    for(int step=0; r != 0; step++)
+    {
+        if(step > depth)
+            return false;
+
+        const int closer = (get(r) + 2) % 3;
+
+        const bool found = forEachSolvingMove(p, [&](Operation op, const pyramid &pp)
+        {
+            const size_t rr = pp.rank();
+
+            if(get(rr) != closer)
+                return false;
+
+            solution.push_back(op);
+            p = pp;
+            r = rr;
+            return true;
+        });
+
+        if(!found)
+            return false;
+    }
+
+    solveTips(start, solution);
+
+    // the rank ignores some invalid configurations, e.g. an odd permutation of the edges
+    if(!isSolution(start, solution))
+        return false;
+
+    moves.splice(moves.end(), solution);
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "pyramid.hpp"
+
+#include <vector>
+#include <string>
+#include <list>
+#include <cstdint>
+
+/**
+ * Stores the distance (in layer moves) of every pyramid configuration to the solved one, modulo 3,
+ * in 2 bits per configuration, indexed by pyramid::rank(). This takes about 230 KB.
+ * Since one move changes the distance by at most one, the distance modulo 3 is enough to tell
+ * which neighbor of a configuration is one move closer to the solution.
+ */
+class DistanceTable
+{
+    public:
+
+    /// builds the table by a breadth-first search from the solved pyramid
+    DistanceTable();
+
+    /// loads the table from a distance table file (see save()). Throws a runtime_error if it is missing or invalid.
+    explicit DistanceTable(const std::string &filename);
+
+    /// stores the table as a distance table file: one byte of entries per record, then one record with maxDistance()
+    void save(const std::string &filename) const;
+
+    /// returns the distance modulo 3 of the configuration with rank r, or UNKNOWN if it is not reachable
+    int get(size_t r) const;
+
+    /// the largest distance of any configuration, as found while building the table
+    int maxDistance() const;
+
+    /**
+     * Finds an optimal sequence of layer moves that solves p apart from its tips,
+     * by always moving to a neighbor whose distance is one less, and appends the tip moves (see solveTips()).
+     * Returns false if p cannot be solved, which means it is no valid configuration.
+     */
+    bool solve(const pyramid &p, std::list<Operation> &moves) const;
+
+    /// marks a configuration that was not reached when building the table
+    static const int UNKNOWN = 3;
+
+    private:
+
+    void set(size_t r, int d);
+
+    /// four entries per byte, the lowest two bits hold the entry with the lowest rank
+    std::vector<uint8_t> entries;
+
+    int depth;
+};
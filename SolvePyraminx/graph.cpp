@@ -0,0 +1,111 @@
+#include "graph.hpp"
+#include "permutation.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+static_assert(sizeof(EdgeRecord) == PyramidGraph::DEGREE * sizeof(Edge), "an edge record holds the edges of one node");
+
+PyramidGraph::PyramidGraph(const std::vector<pyramid> &ps, unsigned int threads) : storage(DEGREE * ps.size()), nodes(ps.size())
+{
+    threads = std::max(threads, 1u);
+
+    std::atomic<bool> unordered(false);
+
+    // thread t computes the edges of the t-th contiguous range of ids, and writes them into its own slice of storage.
+    // The target of an edge is found by its rank, so there is nothing to look up and nothing shared to lock.
+    auto build = [&](unsigned int t)
+    {
+        const size_t begin = ps.size() * t / threads;
+        const size_t end = ps.size() * (t + 1) / threads;
+
+        for(size_t id=begin; id<end && !unordered; id++)
+        {
+            if(ps[id].rank() != id)
+                unordered = true;
+
+            Edge *e = storage.data() + DEGREE * id;
+
+            forEachSolvingMove(ps[id], [&e](Operation op, const pyramid &p)
+            {
+                *e++ = makeEdge(p.rank(), op);
+                return false;
+            });
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for(unsigned int t=1; t<threads; t++)
+        workers.emplace_back(build, t);
+
+    build(0);
+
+    for(std::thread &w: workers)
+        w.join();
+
+    if(unordered)
+        throw std::runtime_error("PyramidGraph: the nodes are not stored in the order of their rank.");
+
+    edges = storage.data();
+}
+
+PyramidGraph::PyramidGraph(const std::string &filename) : table(new MappedTable(filename, TABLE_EDGES, sizeof(EdgeRecord)))
+{
+    edges = table->records<Edge>();
+    nodes = table->size();
+
+    // the checksum is not verified, so make sure a corrupt file cannot make a search index past its arrays
+    for(size_t i=0; i<DEGREE * nodes; i++)
+    {
+        if(edgeTarget(edges[i]) >= nodes)
+            throw std::runtime_error("PyramidGraph: " + filename + " has an edge to node " + std::to_string(edgeTarget(edges[i]))
+                                     + ", but only " + std::to_string(nodes) + " nodes.");
+    }
+}
+
+size_t PyramidGraph::size() const
+{
+    return nodes;
+}
+
+void PyramidGraph::save(const std::string &filename) const
+{
+    writeTable(filename, TABLE_EDGES, edges, sizeof(EdgeRecord), nodes);
+}
+
+/// the edges to the pyramids that the solvingMoves lead p to, in their order, each one applied with its own kernel
+template<size_t... I>
+static std::array<Edge, sizeof...(I)> neighborEdges(const pyramid &p, std::index_sequence<I...>)
+{
+    auto edge = [&p](auto i)
+    {
+        pyramid pp(p);
+        applyOperation<solvingMoves[i()]>(pp);
+        return makeEdge(pp.rank(), solvingMoves[i()]);
+    };
+
+    return {edge(std::integral_constant<size_t, I>())...};
+}
+
+std::array<Edge, ImplicitGraph::DEGREE> ImplicitGraph::neighbors(size_t id) const
+{
+    return neighborEdges(pyramid::unrank(id), std::make_index_sequence<DEGREE>());
+}
+
+SolverContext::SolverContext(size_t nodes) : queue(nodes), pred(nodes), stamps(nodes, 0), generation(0)
+{
+
+}
+
+void SolverContext::reset()
+{
+    // Only when the generation counter wraps around, the stamps must really be cleared.
+    if(++generation == 0)
+    {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        generation = 1;
+    }
+}
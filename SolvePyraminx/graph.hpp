@@ -0,0 +1,221 @@
+#pragma once
+
+#include "pyramid.hpp"
+#include "tablefile.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <list>
+#include <array>
+#include <stdexcept>
+#include <thread>
+
+/// an edge of the PyramidGraph: the id of the target node in the lower 24 bits, the Operation that leads there in the upper 8 bits
+typedef uint32_t Edge;
+
+inline Edge makeEdge(uint32_t target, Operation op)
+{
+    return target | (uint32_t(op) << 24);
+}
+
+inline uint32_t edgeTarget(Edge e)
+{
+    return e & 0xffffff;
+}
+
+inline Operation edgeOperation(Edge e)
+{
+    return Operation(e >> 24);
+}
+
+/**
+ * The graph of all pyramid configurations, where the id of a node is its rank (see pyramid::rank()).
+ * Every node has exactly DEGREE outgoing edges, one for each of the solvingMoves in their order,
+ * so the adjacency is one flat array of DEGREE * size() edges (about 30 MB) instead of a list per node.
+ */
+class PyramidGraph
+{
+    public:
+
+    static const int DEGREE = solvingMoves.size();
+
+    /// builds the graph from the nodes, which must be stored in the order of their rank, split across the given number of threads
+    explicit PyramidGraph(const std::vector<pyramid> &nodes, unsigned int threads = std::thread::hardware_concurrency());
+
+    /// maps the graph from an edge table file, without copying it. Throws a runtime_error if an edge leads to a node that is not in the file.
+    explicit PyramidGraph(const std::string &filename);
+
+    /// the number of nodes
+    size_t size() const;
+
+    /// the DEGREE edges that leave node id
+    const Edge *neighbors(size_t id) const
+    {
+        return edges + DEGREE * id;
+    }
+
+    /// stores the graph as an edge table file
+    void save(const std::string &filename) const;
+
+    private:
+
+    /// holds the edges if the graph was built, and is empty if it was mapped
+    std::vector<Edge> storage;
+
+    /// the mapped edge table, if the graph was mapped
+    std::unique_ptr<MappedTable> table;
+
+    const Edge *edges;
+
+    size_t nodes;
+};
+
+/**
+ * The same graph as PyramidGraph, but without storing any edges: the neighbors of a node are computed when they are asked for,
+ * by unranking it and applying the compiled kernels of the solvingMoves. This needs no memory and no edge file,
+ * and recomputing a few bit permutations costs less than loading 32 bytes of edges from main memory.
+ */
+class ImplicitGraph
+{
+    public:
+
+    static const int DEGREE = PyramidGraph::DEGREE;
+
+    /// the number of nodes
+    size_t size() const
+    {
+        return PYRAMID_STATES;
+    }
+
+    /// the DEGREE edges that leave node id, in the same order as in a PyramidGraph
+    std::array<Edge, DEGREE> neighbors(size_t id) const;
+};
+
+/**
+ * The storage for breadth-first searches on a PyramidGraph, allocated once and reused by every query.
+ * Instead of clearing the visited marks before a query, every query gets a new generation number,
+ * and a node counts as visited if its stamp equals the current generation.
+ * So a query only costs time for the nodes it actually visits. A context must not be used by two threads at once.
+ */
+class SolverContext
+{
+    public:
+
+    /// allocates the storage for searches on graphs of the given number of nodes
+    explicit SolverContext(size_t nodes);
+
+    /**
+     * Finds a shortest path from node start to node target in g, and appends its moves to moves.
+     * Graph is PyramidGraph or ImplicitGraph. Returns false if there is no such path.
+     */
+    template<class Graph>
+    bool search(const Graph &g, size_t start, size_t target, std::list<Operation> &moves);
+
+    private:
+
+    void visit(size_t id)
+    {
+        stamps[id] = generation;
+    }
+
+    bool visited(size_t id) const
+    {
+        return stamps[id] == generation;
+    }
+
+    /// starts a new generation, so that all nodes count as unvisited
+    void reset();
+
+    std::vector<uint32_t> queue;
+
+    /// the edge back to the predecessor of each visited node, together with the move that was taken
+    std::vector<Edge> pred;
+
+    /// the generation in which each node was visited last
+    std::vector<uint32_t> stamps;
+
+    uint32_t generation;
+};
+
+template<class Graph>
+bool SolverContext::search(const Graph &g, size_t start, size_t target, std::list<Operation> &moves)
+{
+    if(g.size() > stamps.size())
+        throw std::runtime_error("SolverContext::search(): the graph is larger than the context.");
+
+    reset();
+
+    size_t head = 0;
+    size_t tail = 0;
+
+    queue[tail++] = start;
+    visit(start);
+
+    bool found = start == target;
+
+    while(!found && head < tail)
+    {
+        size_t u = queue[head++];
+        const auto edges = g.neighbors(u);
+
+        for(int i=0; i<Graph::DEGREE; i++)
+        {
+            size_t v = edgeTarget(edges[i]);
+
+            if(visited(v))
+                continue;
+
+            visit(v);
+            pred[v] = makeEdge(u, edgeOperation(edges[i]));
+            queue[tail++] = v;
+
+            if(v == target)
+            {
+                found = true;
+                break;
+            }
+        }
+    }
+
+    if(!found)
+        return false;
+
+    // walk back from the target, and insert the moves in front of the ones that were there before
+    auto it = moves.end();
+
+    for(size_t v = target; v != start; v = edgeTarget(pred[v]))
+        it = moves.insert(it, edgeOperation(pred[v]));
+
+    return true;
+}
+
+/**
+ * Finds a shortest sequence of layer moves for p by a search on g from the node of p to the solved node, and appends it
+ * to moves followed by the tip moves (see solveTips()). The solution is checked with isSolution(), since the rank of an
+ * invalid configuration can be the one of a valid node. Returns false, and leaves moves unchanged, if p cannot be solved.
+ */
+template<class Graph>
+bool solveOnGraph(SolverContext &ctx, const Graph &g, const pyramid &p, std::list<Operation> &moves)
+{
+    // the id of a node is its rank, and the solved pyramid has rank 0.
+    // The rank does not depend on the orientation, so the moves found in the graph apply to p as it is.
+    const size_t start = p.rank();
+
+    if(start >= g.size())
+        return false;
+
+    std::list<Operation> solution;
+
+    if(!ctx.search(g, start, 0, solution))
+        return false;
+
+    solveTips(p, solution);
+
+    if(!isSolution(p, solution))
+        return false;
+
+    moves.splice(moves.end(), solution);
+    return true;
+}
@@ -0,0 +1,99 @@
+#include "idastar.hpp"
+
+/// the distances from the solved state of all values of a coordinate with the given number of values, which move() moves
+template<class Move>
+static std::vector<uint8_t> coordinateDistances(size_t size, Move move)
+{
+    const uint8_t unknown = 0xff;
+
+    std::vector<uint8_t> distances(size, unknown);
+    std::vector<size_t> q = {0};
+
+    distances.at(0) = 0;
+
+    for(size_t head=0; head<q.size(); head++)
+    {
+        for(Operation op: solvingMoves)
+        {
+            size_t x = move(q.at(head), op);
+
+            if(distances.at(x) == unknown)
+            {
+                distances.at(x) = distances.at(q.at(head)) + 1;
+                q.push_back(x);
+            }
+        }
+    }
+
+    return distances;
+}
+
+PatternDatabase::PatternDatabase(const CoordinateMoves &moves)
+{
+    edges = coordinateDistances(EDGE_COORDINATES, [&moves](size_t e, Operation op){ return moves.moveEdges(e, op); });
+    centers = coordinateDistances(TWIST_COORDINATES, [&moves](size_t c, Operation op){ return moves.moveCenters(c, op); });
+}
+
+/**
+ * Depth-first search below c, which was reached with depth moves, the last one being last.
+ * Returns true if a solution within bound was found, which is then in path.
+ * Otherwise next is lowered to the smallest estimate that exceeded the bound.
+ */
+static bool boundedSearch(const PatternDatabase &pdb, const CoordinateMoves &moves, const CoordinatePyramid &c,
+                          int depth, int bound, Operation last, std::vector<Operation> &path, int &next)
+{
+    if(c.edges == 0 && c.centers == 0)
+        return true;
+
+    int estimate = depth + pdb.heuristic(c);
+
+    if(estimate > bound)
+    {
+        next = std::min(next, estimate);
+        return false;
+    }
+
+    const Operation lastReversed = reverseOp(last);
+
+    for(Operation op: solvingMoves)
+    {
+        // turning the same layer twice in a row is never shorter than turning it once the other way
+        if(op == last || op == lastReversed)
+            continue;
+
+        path.push_back(op);
+
+        if(boundedSearch(pdb, moves, moves.apply(c, op), depth + 1, bound, op, path, next))
+            return true;
+
+        path.pop_back();
+    }
+
+    return false;
+}
+
+bool solveIDAStar(const pyramid &p, std::list<Operation> &moves)
+{
+    const CoordinateMoves &tables = CoordinateMoves::shared();
+    static const PatternDatabase pdb(tables);
+
+    const CoordinatePyramid c(p);
+
+    std::vector<Operation> path;
+
+    // God's number of the pyramid without tips is 11, so any larger bound means that p is no valid configuration
+    for(int bound = pdb.heuristic(c); bound <= 11; )
+    {
+        int next = INT32_MAX;
+
+        if(boundedSearch(pdb, tables, c, 0, bound, OP_NOOP, path, next))
+        {
+            moves.insert(moves.end(), path.begin(), path.end());
+            return true;
+        }
+
+        bound = next;
+    }
+
+    return false;
+}
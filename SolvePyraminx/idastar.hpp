@@ -0,0 +1,42 @@
+#pragma once
+
+#include "pyramid.hpp"
+#include "coordinates.hpp"
+
+#include <vector>
+#include <list>
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * Lower bounds for the number of moves that solve a pyramid, taken from two small pattern databases.
+ * Each one holds the exact distance of a coordinate of the state (see CoordinatePyramid): the permutation and orientation
+ * of the edges (11520 entries) and the twists of the axial centers (81 entries). Together about 12 KB.
+ */
+class PatternDatabase
+{
+    public:
+
+    /// builds both databases by breadth-first searches over the values of the coordinates
+    explicit PatternDatabase(const CoordinateMoves &moves);
+
+    /// a lower bound for the number of layer moves that solve c apart from its tips
+    int heuristic(const CoordinatePyramid &c) const
+    {
+        return std::max(edges[c.edges], centers[c.centers]);
+    }
+
+    private:
+
+    std::vector<uint8_t> edges;
+
+    std::vector<uint8_t> centers;
+};
+
+/**
+ * Finds a shortest sequence of layer moves that solves p apart from its tips, with an iterative deepening A* search
+ * on the coordinates of p. Apart from the move tables and pattern databases, it only needs memory linear in the length of the solution.
+ * Returns false if no solution within God's number is found. The coordinates do not tell every invalid configuration
+ * from a valid one, so callers check the moves with isSolution(), as solve() does.
+ */
+bool solveIDAStar(const pyramid &p, std::list<Operation> &moves);
@@ -1,16 +1,29 @@
 
 #include "pyramid.hpp"
 #include "testpyramid.hpp"
+#include "distancetable.hpp"
+#include "tablefile.hpp"
+#include "graph.hpp"
+#include "statespace.hpp"
+#include "batch.hpp"
+#include "service.hpp"
+#include "benchmark.hpp"
 
 #include <iostream>
 #include <unordered_map>
 #include <unordered_set>
 #include <list>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <functional>
 #include <fstream>
+#include <csignal>
 
-using namespace std;
+#include <pthread.h>
 
-void findEdges(vector<pyramid> &nodes, vector<list<size_t>> &G);
+using namespace std;
 
 void testSolve()
 {
@@ -42,9 +55,14 @@ void generateEdges();
 
 void loadNodes(vector<pyramid> &ps);
 
-void loadEdges(vector<list<size_t>> &g);
+// the distance table from distances.bin, which generateDistances() writes, or a new one if the file cannot be loaded.
+DistanceTable loadDistanceTable();
+
+// build the distance table and save it to file
+void generateDistances();
 
-void solverLoop()
+// read pyramids from the console and print the solutions that solver finds, until the user types 'exit'.
+void solverLoop(const function<bool(const pyramid&, list<Operation>&)> &solver)
 {
     while(true)
     {
@@ -61,7 +79,7 @@ void solverLoop()
 
             list<Operation> solution;
 
-            if(solve(p, solution))
+            if(solver(p, solution))
             {
                 cout << "The puzzle was solved like so:" << endl << endl;
 
@@ -81,378 +99,335 @@ void solverLoop()
     return;
 }
 
-// find the rotations so that p0 becomes p1
-void findRotation(const pyramid &p0, const pyramid &p1, list<Operation> &solution);
+// solve the problem using the graph g (a PyramidGraph or an ImplicitGraph), with the storage of ctx.
+template<class Graph>
+void bfsSolve(SolverContext &ctx, const Graph &g, list<Operation> &solution, const pyramid &inst);
 
-// find the Operation that turns p0 into p1
-Operation findOperation(const pyramid &p0, const pyramid &p1);
+// measure how well hashPyramid spreads all configurations over the buckets of a hash table, compared to the former hash.
+void hashStatistics();
 
-// solve the problem using the precomputed graph.
-void bfsSolve(const vector<pyramid> &ps, const vector<list<size_t>> g, list<Operation> &solution, const pyramid &inst);
-
-int main()
+int main(int argc, char *argv[])
 {
-    ///*
-    solverLoop();
-    /*/
-    vector<pyramid> ps;
-
-    loadNodes(ps);
-
-    vector<list<size_t>> g;
-
-    loadEdges(g);
-
-    list<Operation> solution;
-
-    pyramid problem("b9,g9,y9,r9");
-
-    // problem.turnLeft();
-    problem.rotateRightUp();
-    problem.rotateLeftDown();
-    problem.rotateTopLeft();
+    string mode = argc > 1 ? argv[1] : "";
 
-    bfsSolve(ps, g, solution, problem);
+    if(mode == "hashstats")
+    {
+        hashStatistics();
+        return 0;
+    }
 
-    for(Operation op: solution)
-        cout << operationToString(op) << endl;//*/
-}
+    if(mode == "generate")
+    {
+        generateNodes();
+        generateEdges();
+        generateDistances();
+        return 0;
+    }
 
-void findEdges(vector<pyramid> &ps, vector<list<size_t>> &G)
-{
-    cout << "build_graph()..." << endl;
+    if(mode == "bench")
+    {
+        // bench [csv|json] [seconds]: measure the hot paths, each for at least the given time
+        bool json = argc > 2 && string(argv[2]) == "json";
+        double seconds = argc > 3 ? stod(argv[3]) : 0.2;
 
-    list<Operation> ops =   { OP_UPPER_RIGHT, OP_UPPER_LEFT, OP_RIGHT_UP, OP_RIGHT_DOWN
-                            , OP_LEFT_UP, OP_LEFT_DOWN, OP_BACK_CLOCKWISE, OP_BACK_COUNTER_CLOCKWISE };
+        writeBenchmarks(cout, runBenchmarks(seconds), json);
+        return 0;
+    }
 
-    cout << "loading the nodes from file..." << endl;
+    if(mode == "batch")
+    {
+        // batch [file] [threads]: solve all pyramids of the file (or of stdin, if there is none or it is "-")
+        string filename = argc > 2 ? argv[2] : "-";
+        unsigned int threads = argc > 3 ? stoul(argv[3]) : thread::hardware_concurrency();
 
-    loadNodes(ps);
+        ifstream file;
 
-    cout << "loaded " << ps.size() << " nodes." << endl;
+        if(filename != "-")
+        {
+            file.open(filename);
 
-    unordered_map<pyramid, size_t, hashPyramid> trans;  // translate pyramids into ids.
-    size_t id = 0;
+            if(!file)
+            {
+                cerr << "could not open " << filename << endl;
+                return 1;
+            }
+        }
 
-    cout << "building a translation table..." << endl;
+        const DistanceTable table = loadDistanceTable();
 
-    for(const pyramid &p: ps)
-        trans.insert({p, id++});
+        auto start = chrono::steady_clock::now();
 
-    cout << "done." << endl << "finding all edges now..." << endl;
+        size_t solved = solveBatch(filename == "-" ? cin : file, cout,
+                                   [&table](const pyramid &p, list<Operation> &moves){ return table.solve(p, moves); }, threads);
 
-    G.clear();
-    G = vector<list<size_t>>(ps.size(), list<size_t>());
+        auto time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-    size_t percent = ps.size() / 100;
-    size_t lastNotification = 0;
+        cerr << solved << " pyramids were solved on " << threads << " threads in " << time << " s." << endl;
+        return 0;
+    }
 
-    for(size_t id=0; id<ps.size(); id++)
+    if(mode == "serve")
     {
-        pyramid &u = ps.at(id);
+        // serve [socket]: answer solve requests until SIGINT or SIGTERM, see SolverService for the protocol
+        string path = argc > 2 ? argv[2] : "/tmp/pyraminx.sock";
 
-        for(Operation op: ops)
-        {
-            pyramid p(u);
+        // the signals are blocked in every thread and taken by sigwait() in one of them, since stop() locks a mutex
+        // and so must not be called from a signal handler. Then run() returns, and the destructor removes the socket.
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
 
-            executeOperation(p, op);
+        const DistanceTable table = loadDistanceTable();
 
-            size_t pID = trans.at(p);
-            G.at(id).push_back(pID);
-        }
+        SolverService service(path, [&table](const pyramid &p, list<Operation> &moves){ return table.solve(p, moves); });
 
-        if(id > lastNotification + percent)
+        thread waiter([&service, &signals]
         {
-            lastNotification = id;
-            cout << (id / percent) << " %." << endl;
-        }
-    }
-
-    cout << "generated the whole graph." << endl;
-}
-
-void generateNodes()
-{
-    cout << "generate()..." << endl;
+            int signal;
+            sigwait(&signals, &signal);
+            service.stop();
+        });
 
-    Operation ops[] =   {OP_UPPER_RIGHT,OP_UPPER_LEFT,OP_RIGHT_UP,OP_RIGHT_DOWN
-                        ,OP_LEFT_UP,OP_LEFT_DOWN,OP_BACK_CLOCKWISE,OP_BACK_COUNTER_CLOCKWISE};
+        cerr << "listening on " << path << endl;
 
-    unordered_set<pyramid, hashPyramid> S = {pyramid("b9,g9,y9,r9")};
+        service.run();
 
-    std::cout << "starting the generation of pyramids..." << std::endl;
+        // wakes up the waiter if run() returned for another reason
+        pthread_kill(waiter.native_handle(), SIGTERM);
+        waiter.join();
+        return 0;
+    }
 
-    do
+    if(mode == "implicit")
     {
-        for(const pyramid &p: S)
+        // breadth-first searches on the graph, with neighbors computed on the fly, so that no edge file is needed
+        const ImplicitGraph g;
+        SolverContext ctx(g.size());
+
+        solverLoop([&](const pyramid &p, list<Operation> &solution)
         {
-            if(p.marked)
-                continue;
+            bfsSolve(ctx, g, solution, p);
+            return !solution.empty();
+        });
 
-            bool marked = true;
+        return 0;
+    }
 
-            for(Operation &op: ops)
-            {
-                pyramid pp(p);
+    ///*
+    cout << "loading the distance table..." << endl;
 
-                executeOperation(pp, op);
+    const DistanceTable table = loadDistanceTable();
 
-                if(!S.contains(pp))
-                {
-                    S.insert(pp);
-                    marked = false;
-                }
-            }
+    cout << "done, every pyramid can be solved in at most " << table.maxDistance() << " moves." << endl;
 
-            p.marked = marked;
-        }
+    solverLoop([&table](const pyramid &p, list<Operation> &solution){ return table.solve(p, solution); });
+    /*/
+    const PyramidGraph g("edges.bin");
 
-    } while(S.size() < 933120);
-    
-    cout << S.size() << " different pyramids were generated." << endl;
+    SolverContext ctx(g.size());
 
-    ofstream savefile("nodes.txt");
+    list<Operation> solution;
 
-    if(!savefile.good())
-        throw runtime_error("Could not open file to store pyramid nodes.");
-    
-    cout << "saving the pyramids to file..." << endl;
+    pyramid problem("b9,g9,y9,r9");
 
-    for(const pyramid &p: S)
-        savefile << p.storageString() << endl;
-    
-    savefile.close();
+    // problem.turnLeft();
+    problem.rotateRightUp();
+    problem.rotateLeftDown();
+    problem.rotateTopLeft();
 
-    cout << "saved all pyramids." << endl;
+    bfsSolve(ctx, g, solution, problem);
 
-    return;
+    for(Operation op: solution)
+        cout << operationToString(op) << endl;//*/
 }
 
-void generateEdges()
+/// print collision and bucket occupancy statistics of hash function h over ps, in a table with the given number of buckets
+template<class Hash>
+static void reportHashStatistics(const string &name, Hash h, const vector<pyramid> &ps, size_t buckets)
 {
-    cout << "createAndStoreNodes()..." << endl;
-
-    vector<pyramid> nodes;
-    vector<list<size_t>> edges;
-
-    findEdges(nodes, edges);
+    vector<size_t> hashes;
+    hashes.reserve(ps.size());
 
-    ofstream edgesfile("edges.txt");
+    for(const pyramid &p: ps)
+        hashes.push_back(h(p));
 
-    if(!edgesfile.good())
-        throw runtime_error("Could not open file to store finished pyramid nodes.");
-    
-    cout << "saving the edges to file..." << endl;
+    vector<size_t> occupancy(buckets, 0);
 
-    for(auto &l: edges)
-    {
-        size_t i=0;
+    for(size_t x: hashes)
+        occupancy.at(x % buckets)++;
 
-        for(size_t id: l)
-        {
-            edgesfile << id;
-            i++;
+    sort(hashes.begin(), hashes.end());
+    size_t distinct = unique(hashes.begin(), hashes.end()) - hashes.begin();
 
-            if(i < l.size())
-                edgesfile << ',';
-        }
+    size_t used = 0;
+    size_t largest = 0;
+    double probes = 0;              // the average number of elements in the bucket of a stored element
+    map<size_t, size_t> histogram;  // bucket size -> number of buckets
 
-        edgesfile << endl;
+    for(size_t n: occupancy)
+    {
+        used += n > 0;
+        largest = max(largest, n);
+        probes += double(n) * n / ps.size();
+        histogram[min<size_t>(n, 8)]++;
     }
-    
-    edgesfile.close();
 
-    cout << "everything saved and closed." << endl;
+    cout << name << ":" << endl;
+    cout << "  distinct hash values:  " << distinct << " (" << (ps.size() - distinct) << " colliding pyramids)" << endl;
+    cout << "  buckets used:          " << used << " of " << buckets << endl;
+    cout << "  largest bucket:        " << largest << endl;
+    cout << "  average chain length:  " << probes << endl;
+    cout << "  buckets by size:      ";
 
-    return;
+    for(auto [n, count]: histogram)
+        cout << " " << n << (n == 8 ? "+" : "") << ":" << count;
+
+    cout << endl << endl;
 }
 
-void loadNodes(vector<pyramid> &ps)
+void hashStatistics()
 {
-    cout << "loadNodes()..." << endl;
+    cout << "hashStatistics()..." << endl;
 
-    ifstream ifs("nodes.txt");
+    vector<pyramid> ps;
+    ps.reserve(PYRAMID_STATES);
 
-    if(!ifs.good())
-        throw runtime_error("Could not read nodes from file.");
-    
-    ps.clear();
+    for(size_t r=0; r<PYRAMID_STATES; r++)
+        ps.push_back(pyramid::unrank(r));
 
-    while(ifs.good())
-    {
-        string s;
+    // insert all pyramids into a real set, to get the bucket count the standard library chooses
+    unordered_set<pyramid, hashPyramid> S;
+    S.reserve(ps.size());
 
-        getline(ifs, s);
+    auto start = chrono::steady_clock::now();
 
-        if(ifs.eof())       // there is one last newline which leads to an empty string that cannot be parsed.
-            break;
+    for(const pyramid &p: ps)
+        S.insert(p);
 
-        ps.push_back(pyramid(s));
-    }
+    auto time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-    ifs.close();
+    size_t largest = 0;
 
-    cout << ps.size() << " nodes were loaded successfuly." << endl;
+    for(size_t b=0; b<S.bucket_count(); b++)
+        largest = max(largest, S.bucket_size(b));
+
+    cout << "inserted " << S.size() << " pyramids in " << time << " s, load factor " << S.load_factor()
+         << ", largest bucket " << largest << "." << endl << endl;
+
+    reportHashStatistics("hashPyramid", hashPyramid(), ps, S.bucket_count());
+    reportHashStatistics("former hash", hashPyramid::legacyHash, ps, S.bucket_count());
 }
 
-void loadEdges(vector<list<size_t>> &g)
+void generateNodes()
 {
-    cout << "loadEdges()..." << endl;
-    ifstream ifs("edges.txt");
+    cout << "generate()..." << endl;
 
-    if(!ifs.good())
-        throw runtime_error("Could not read nodes from file.");
-    
-    g.clear();
+    std::cout << "starting the generation of pyramids on " << thread::hardware_concurrency() << " threads..." << std::endl;
 
-    while(ifs.good())
+    const StateSpace space(thread::hardware_concurrency(), [](int depth, size_t count)
     {
-        string s;
-
-        getline(ifs, s);
+        cout << "  depth " << depth << ": " << count << " pyramids" << endl;
+    });
 
-        if(ifs.eof())                   // there is one last newline which leads to an empty string that cannot be parsed.
-            break;
-        else
-            g.push_back({});
+    cout << space.size() << " different pyramids were generated." << endl;
 
-        const char delimiter = ',';
+    cout << "saving the pyramids to file..." << endl;
 
-        size_t pos = 0;
-        vector<string> tokens;
+    // store them in the order of their rank, so that the index of a pyramid is its rank.
+    vector<NodeRecord> records;
+    records.reserve(space.size());
 
-        while(s.size() > 0)
+    for(size_t r=0; r<PYRAMID_STATES; r++)
+    {
+        if(space.contains(r))
         {
-            pos = s.find(delimiter);
-            tokens.push_back(s.substr(0, pos));
-
-            if(pos == std::string::npos)
-                break;
-            else
-                s.erase(0, pos + 1);
+            records.push_back({});
+            pyramid::unrank(r).getBits(records.back().surfaces);
         }
-
-        for(string &t: tokens)
-            g.back().push_back(stoul(t));
     }
 
-    ifs.close();
+    writeTable("nodes.bin", TABLE_NODES, records.data(), sizeof(NodeRecord), records.size());
 
-    cout << "loaded a graph with " << g.size() << " nodes." << endl;
+    cout << "saved all pyramids." << endl;
+
+    return;
 }
 
-void bfsSolve(const vector<pyramid> &ps, const vector<list<size_t>> g, list<Operation> &solution, const pyramid &inst)
+void generateEdges()
 {
-    solution.clear();
+    cout << "generateEdges()..." << endl;
 
-    // trivial check:
-    if(inst.isSolved())
-    {
-        solution.push_back(OP_NOOP);    // because an empty solution means that no solution was found, which isn't the case.
-        return;
-    }
+    vector<pyramid> nodes;
 
-    // first, let's find the right starting point, and also reset the marked flags
-    size_t startID = -1;
+    loadNodes(nodes);
 
-    for(size_t id=0; id<ps.size(); id++)
-    {
-        if(ps.at(id) == inst)
-            startID = id;
-        
-        ps.at(id).marked = false;
-    }
-    
-    if(startID == -1)
-    {
-        cout << "The right entry point was not found!" << endl;
-        return;
-    }
+    cout << "finding all edges now..." << endl;
 
-    ps.at(startID).marked = true;
+    const PyramidGraph g(nodes);
 
-    // so we have everything in order later for backtracking
-    list<Operation> rotationSolution;
-    
-    // turn the pyramid, so that it becomes exactly the one in the graph.
-    if(!inst.equal(ps.at(startID)))
-        findRotation(inst, ps.at(startID), rotationSolution);
+    cout << "saving the edges to file..." << endl;
 
-    // bfs queue
-    list<size_t> q;
-    q.push_back(startID);
+    g.save("edges.bin");
 
-    // bfs predecessor array
-    vector<size_t> pred(ps.size());
-    pred.at(startID) = startID;
+    cout << "everything saved and closed." << endl;
 
-    // solution target:
-    const pyramid target("b9,g9,y9,r9");
-    bool solved = false;
+    return;
+}
 
-    while(!(solved || q.empty()))
-    {
-        size_t uID = q.front();
-        q.pop_front();
+void generateDistances()
+{
+    cout << "generateDistances()..." << endl;
 
-        for(size_t vID: g.at(uID))      // iterate over all neighbors
-        {
-            const pyramid &v = ps.at(vID);
-
-            if(v.marked)                // was visited before, skip.
-                continue;
-            
-            v.marked = true;            // mark the previously unknown node
-            pred.at(vID) = uID;         // set u to be the predecessor of v
-            q.push_back(vID);           // and add v to the queue
-            
-            if(v == target)             // we've found the solution!
-            {
-                solved = true;
-                break;
-            }
+    const DistanceTable table;
 
-            q.push_back(vID);           // add unknown node to the queue
-        }
-    }
+    table.save("distances.bin");
 
-    if(q.empty())
+    cout << "saved the distances, every pyramid can be solved in at most " << table.maxDistance() << " moves." << endl;
+}
+
+DistanceTable loadDistanceTable()
+{
+    try
     {
-        cout << "No solution was found!" << endl;
-        return;
+        return DistanceTable("distances.bin");
     }
-    
-    // do all of the backtracking
-    size_t pID = q.back();
-
-    while(pID != startID)
+    catch(const std::exception &e)
     {
-        const pyramid &p1 = ps.at(pID);
-        pID = pred.at(pID);
-        const pyramid &p0 = ps.at(pID);
-        solution.push_back(findOperation(p0, p1));
+        // stderr, since the batch mode writes its solutions to stdout
+        cerr << e.what() << endl << "building the distance table instead, run 'generate' to save it." << endl;
+        return DistanceTable();
     }
-
-    for(Operation rot: rotationSolution)
-        solution.push_front(rot);
 }
 
-void findRotation(const pyramid &p0, const pyramid &p1, list<Operation> &solution)
+void loadNodes(vector<pyramid> &ps)
 {
-    cout << "Rotate " << p0 << " so that it becomes " << p1 << endl;
+    cout << "loadNodes()..." << endl;
+
+    // the nodes are only loaded to build the edges from them, so a corrupt file must not end up in the edge table
+    const MappedTable table("nodes.bin", TABLE_NODES, sizeof(NodeRecord), true);
+    const NodeRecord *records = table.records<NodeRecord>();
+
+    ps.assign(table.size(), pyramid(RED, RED, RED, RED));
+
+    for(size_t id=0; id<ps.size(); id++)
+        ps.at(id).setBits(records[id].surfaces);
+
+    cout << ps.size() << " nodes were loaded successfuly." << endl;
 }
 
-Operation findOperation(const pyramid &p0, const pyramid &p1)
+template<class Graph>
+void bfsSolve(SolverContext &ctx, const Graph &g, list<Operation> &solution, const pyramid &inst)
 {
-    for(Operation op: allOperations)
-    {
-        pyramid p(p0);
-
-        executeOperation(p, op);
+    solution.clear();
 
-        if(p.equal(p1))
-            return op;
+    if(!solveOnGraph(ctx, g, inst, solution))
+    {
+        cout << "No solution was found!" << endl;
+        return;
     }
 
-    throw runtime_error("findOperation(): no operation turns '" + p0.storageString() + "' into '" + p1.storageString() + "'.");
+    if(solution.empty())
+        solution.push_back(OP_NOOP);    // because an empty solution means that no solution was found, which isn't the case.
 }
@@ -0,0 +1,405 @@
+#pragma once
+
+#include "pyramid.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/// the number of tiles of a pyramid. Tile number s*9+i is the tile at index i of the surface with Face s.
+const int PYRAMID_TILES = 36;
+
+/**
+ * A permutation of the tiles of a pyramid: the color on tile t moves to tile target[t].
+ * All operations are described this way, and compiled into bit masks and shifts (see PermutationKernel).
+ */
+struct FaceletPermutation
+{
+    std::array<uint8_t, PYRAMID_TILES> target;
+
+    /// the permutation that leaves all tiles in place
+    static constexpr FaceletPermutation identity()
+    {
+        FaceletPermutation p{};
+
+        for(int t=0; t<PYRAMID_TILES; t++)
+            p.target[t] = t;
+
+        return p;
+    }
+
+    /**
+     * Builds a permutation from a list of cycles, separated by commas. Each cycle is a list of tiles,
+     * written as the surface letter (F, R, L or D for the bottom) followed by the index of the tile,
+     * e.g. "F0 R0 L0" means that F0 moves to R0, R0 to L0 and L0 back to F0.
+     * Tiles that are not mentioned stay in place. A malformed spec does not compile when used in a constant expression.
+     */
+    static constexpr FaceletPermutation fromCycles(std::string_view spec)
+    {
+        FaceletPermutation p = identity();
+
+        int first = -1;
+        int previous = -1;
+        size_t i = 0;
+
+        while(i <= spec.size())
+        {
+            char c = i < spec.size() ? spec[i] : ',';
+
+            if(c == ' ')
+            {
+                i++;
+                continue;
+            }
+
+            if(c == ',')
+            {
+                if(previous != -1)
+                    p.target[previous] = first;
+
+                first = previous = -1;
+                i++;
+                continue;
+            }
+
+            if(i + 1 >= spec.size() || spec[i+1] < '0' || spec[i+1] > '8')
+                throw std::invalid_argument("FaceletPermutation::fromCycles(): tile without index");
+
+            int tile = spec[i+1] - '0';
+
+            switch(c)
+            {
+                case 'F': tile += 9*FACE_FRONT; break;
+                case 'R': tile += 9*FACE_RIGHT; break;
+                case 'L': tile += 9*FACE_LEFT; break;
+                case 'D': tile += 9*FACE_BOTTOM; break;
+                default:
+                    throw std::invalid_argument("FaceletPermutation::fromCycles(): unknown surface");
+            }
+
+            if(previous == -1)
+                first = tile;
+            else
+                p.target[previous] = tile;
+
+            previous = tile;
+            i += 2;
+        }
+
+        return p;
+    }
+
+    /// the permutation that undoes this one
+    constexpr FaceletPermutation inverse() const
+    {
+        FaceletPermutation p{};
+
+        for(int t=0; t<PYRAMID_TILES; t++)
+            p.target[target[t]] = t;
+
+        return p;
+    }
+
+    constexpr bool operator==(const FaceletPermutation &p) const = default;
+
+    /// the permutation that first does this one and then p
+    constexpr FaceletPermutation then(const FaceletPermutation &p) const
+    {
+        FaceletPermutation q{};
+
+        for(int t=0; t<PYRAMID_TILES; t++)
+            q.target[t] = p.target[target[t]];
+
+        return q;
+    }
+};
+
+/// one step of a PermutationKernel: the masked tiles of surface from are shifted (left if positive) into surface to.
+struct PermutationTerm
+{
+    uint8_t from;
+    uint8_t to;
+    int8_t shift;
+    uint32_t mask;
+};
+
+/// A FaceletPermutation compiled into the fewest mask/shift steps: all tiles with the same source, target and shift are merged.
+struct PermutationKernel
+{
+    std::array<PermutationTerm, PYRAMID_TILES> terms;
+    int size;
+
+    constexpr PermutationKernel(const FaceletPermutation &p) : terms{}, size(0)
+    {
+        // one pass per target surface, so that the terms are ordered by it and applyKernel() at runtime can collect each surface in a register
+        for(uint8_t to=0; to<4; to++)
+        {
+            // the index of the term of every source surface and shift (divided by 2, plus 8) into this target surface, -1 if there is none yet
+            int index[4][17] = {};
+
+            for(auto &shifts: index)
+                for(int &k: shifts)
+                    k = -1;
+
+            for(int t=0; t<PYRAMID_TILES; t++)
+            {
+                if(p.target[t] / 9 != to)
+                    continue;
+
+                // index 0 of a surface is stored in the highest two bits (see surface::elements)
+                uint8_t from = t / 9;
+                int fromBit = 2*(8 - t % 9);
+                int8_t shift = 2*(8 - p.target[t] % 9) - fromBit;
+
+                int &k = index[from][shift/2 + 8];
+
+                if(k == -1)
+                {
+                    k = size;
+                    terms[size++] = {from, to, shift, 0};
+                }
+
+                terms[k].mask |= 0b11u << fromBit;
+            }
+        }
+    }
+};
+
+template<PermutationKernel K, size_t... I>
+inline void applyTerms(const unsigned int in[4], unsigned int out[4], std::index_sequence<I...>)
+{
+    ((out[K.terms[I].to] |= K.terms[I].shift >= 0 ? (in[K.terms[I].from] & K.terms[I].mask) << K.terms[I].shift
+                                                   : (in[K.terms[I].from] & K.terms[I].mask) >> -K.terms[I].shift), ...);
+}
+
+/// permute the bitfields of the four surfaces (in the order of Face) with a kernel known at compile time, fully unrolled.
+template<PermutationKernel K>
+inline void applyKernel(unsigned int bits[4])
+{
+    const unsigned int in[4] = {bits[0], bits[1], bits[2], bits[3]};
+
+    bits[0] = bits[1] = bits[2] = bits[3] = 0;
+
+    applyTerms<K>(in, bits, std::make_index_sequence<K.size>());
+}
+
+template<PermutationKernel K>
+inline void applyKernel(pyramid &p)
+{
+    unsigned int bits[4];
+    p.getBits(bits);
+    applyKernel<K>(bits);
+    p.setBits(bits);
+}
+
+/// permute the bitfields of the four surfaces with a kernel built at runtime, one step after the other.
+inline void applyKernel(const PermutationKernel &k, unsigned int bits[4])
+{
+    const unsigned int in[4] = {bits[0], bits[1], bits[2], bits[3]};
+    int i = 0;
+
+    for(int s=0; s<4; s++)
+    {
+        unsigned int out = 0;
+
+        // the masked tiles never wrap around, so a rotation by a negative amount is the right shift, without a branch
+        for(; i < k.size && k.terms[i].to == s; i++)
+            out |= std::rotl(in[k.terms[i].from] & k.terms[i].mask, k.terms[i].shift);
+
+        bits[s] = out;
+    }
+}
+
+inline void applyKernel(const PermutationKernel &k, pyramid &p)
+{
+    unsigned int bits[4];
+    p.getBits(bits);
+    applyKernel(k, bits);
+    p.setBits(bits);
+}
+
+/// the spec of every operation, written as the cycles in which the tiles move.
+constexpr FaceletPermutation turnLeftPermutation = FaceletPermutation::fromCycles(
+    "F0 L0 R0, F1 L1 R1, F2 L2 R2, F3 L3 R3, F4 L4 R4, F5 L5 R5, F6 L6 R6, F7 L7 R7, F8 L8 R8,"
+    "D0 D4 D8, D1 D6 D3, D2 D5 D7");
+
+constexpr FaceletPermutation rightCornerUpPermutation = FaceletPermutation::fromCycles(
+    "F0 L4 D4, F1 L6 D6, F2 L5 D5, F3 L1 D1, F4 L8 D8, F5 L7 D7, F6 L3 D3, F7 L2 D2, F8 L0 D0,"
+    "R0 R8 R4, R1 R3 R6, R2 R7 R5");
+
+constexpr FaceletPermutation leftCornerUpPermutation = FaceletPermutation::fromCycles(
+    "F0 R8 D8, F1 R3 D3, F2 R7 D7, F3 R6 D6, F4 R0 D0, F5 R2 D2, F6 R1 D1, F7 R5 D5, F8 R4 D4,"
+    "L0 L4 L8, L1 L6 L3, L2 L5 L7");
+
+constexpr FaceletPermutation upperRightPermutation = FaceletPermutation::fromCycles("F0 R0 L0, F1 R1 L1, F2 R2 L2, F3 R3 L3");
+
+constexpr FaceletPermutation rightUpPermutation = FaceletPermutation::fromCycles("F3 R6 D6, F6 R1 D1, F7 R5 D5, F8 R4 D4");
+
+constexpr FaceletPermutation leftUpPermutation = FaceletPermutation::fromCycles("F1 L6 D6, F4 L8 D8, F5 L7 D7, F6 L3 D3");
+
+constexpr FaceletPermutation backClockwisePermutation = FaceletPermutation::fromCycles("R3 D1 L6, R6 D3 L1, R7 D2 L5, R8 D0 L4");
+
+constexpr FaceletPermutation rightestUpPermutation = FaceletPermutation::fromCycles("F8 R4 D4");
+
+constexpr FaceletPermutation topRightPermutation = FaceletPermutation::fromCycles("F0 R0 L0");
+
+constexpr FaceletPermutation leftestUpPermutation = FaceletPermutation::fromCycles("F4 L8 D8");
+
+constexpr FaceletPermutation backestClockwisePermutation = FaceletPermutation::fromCycles("R8 D0 L4");
+
+/// the permutation of every Operation, indexed by the Operation
+constexpr std::array<FaceletPermutation, OPERATION_COUNT> operationPermutations = {
+    FaceletPermutation::identity(),
+    turnLeftPermutation, turnLeftPermutation.inverse(),
+    rightCornerUpPermutation, rightCornerUpPermutation.inverse(),
+    leftCornerUpPermutation, leftCornerUpPermutation.inverse(),
+    upperRightPermutation, upperRightPermutation.inverse(),
+    rightUpPermutation, rightUpPermutation.inverse(),
+    leftUpPermutation, leftUpPermutation.inverse(),
+    backClockwisePermutation, backClockwisePermutation.inverse(),
+    rightestUpPermutation, rightestUpPermutation.inverse(),
+    topRightPermutation, topRightPermutation.inverse(),
+    leftestUpPermutation, leftestUpPermutation.inverse(),
+    backestClockwisePermutation, backestClockwisePermutation.inverse()
+};
+
+/// the 12 orientations of the whole pyramid, generated by turning it left and rotating its right corner up. Entry 0 is the identity.
+constexpr std::array<FaceletPermutation, 12> wholeRotations = []()
+{
+    std::array<FaceletPermutation, 12> rotations{};
+    rotations[0] = FaceletPermutation::identity();
+    int n = 1;
+
+    for(int i=0; i<n; i++)
+    {
+        for(const FaceletPermutation &generator: {turnLeftPermutation, rightCornerUpPermutation})
+        {
+            FaceletPermutation r = rotations[i].then(generator);
+
+            bool known = false;
+            for(int j=0; j<n; j++)
+                known = known || rotations[j] == r;
+
+            if(!known)
+                rotations[n++] = r;
+        }
+    }
+
+    return rotations;
+}();
+
+/// executes op on p with its compiled kernel
+template<Operation op>
+inline void applyOperation(pyramid &p)
+{
+    applyKernel<PermutationKernel(operationPermutations[op])>(p);
+}
+
+template<size_t... I>
+constexpr std::array<void (*)(pyramid&), OPERATION_COUNT> operationFunctionTable(std::index_sequence<I...>)
+{
+    return {&applyOperation<Operation(I)>...};
+}
+
+/// the compiled kernel of every Operation, indexed by the Operation. executeOperation() calls these instead of switching over op.
+constexpr std::array<void (*)(pyramid&), OPERATION_COUNT> operationFunctions = operationFunctionTable(std::make_index_sequence<OPERATION_COUNT>());
+
+template<class F, size_t... I>
+inline bool forEachSolvingMove(const pyramid &p, F &f, std::index_sequence<I...>)
+{
+    return ([&]()
+    {
+        pyramid moved(p);
+        applyOperation<solvingMoves[I]>(moved);
+        return f(solvingMoves[I], static_cast<const pyramid&>(moved));
+    }() || ...);
+}
+
+/**
+ * calls f(op, moved) for each of the solvingMoves op in their order, where moved is p after op, until f returns true.
+ * The loop is unrolled, and each move runs its compiled kernel without a dispatch. Returns true if f did.
+ */
+template<class F>
+inline bool forEachSolvingMove(const pyramid &p, F &&f)
+{
+    return forEachSolvingMove(p, f, std::make_index_sequence<solvingMoves.size()>());
+}
+
+/// the permutation of the operations ops, executed from left to right
+template<Operation... ops>
+constexpr FaceletPermutation sequencePermutation()
+{
+    FaceletPermutation p = FaceletPermutation::identity();
+
+    ((p = p.then(operationPermutations[ops])), ...);
+
+    return p;
+}
+
+/**
+ * executes the operations ops on p from left to right, with one kernel for the whole sequence, e.g.
+ * apply<OP_RIGHT_UP, OP_UPPER_LEFT>(p) does the same as p.rotateRightUp(); p.rotateUpperLeft();
+ */
+template<Operation... ops>
+inline void apply(pyramid &p)
+{
+    applyKernel<PermutationKernel(sequencePermutation<ops...>())>(p);
+}
+
+/**
+ * A sequence of operations that is only known at runtime, fused into one PermutationKernel.
+ * Applying it takes about half as long as executing an 11 move sequence one operation after the other, but building it
+ * takes a few times as long, so it pays off when the same sequence is applied to several pyramids.
+ */
+class MacroOperation
+{
+    public:
+
+    /// fuses the operations of sequence, executed from front to back. Throws a std::runtime_error on an unknown operation.
+    explicit MacroOperation(const std::list<Operation> &sequence) : permutation(compose(sequence)), kernel(permutation)
+    {
+
+    }
+
+    void apply(unsigned int bits[4]) const
+    {
+        applyKernel(kernel, bits);
+    }
+
+    void apply(pyramid &p) const
+    {
+        applyKernel(kernel, p);
+    }
+
+    /// the permutation of the tiles that the whole sequence does
+    const FaceletPermutation &getPermutation() const
+    {
+        return permutation;
+    }
+
+    private:
+
+    static FaceletPermutation compose(const std::list<Operation> &sequence)
+    {
+        FaceletPermutation p = FaceletPermutation::identity();
+
+        for(Operation op: sequence)
+        {
+            if(op < 0 || op >= OPERATION_COUNT)
+                throw std::runtime_error("MacroOperation(): unknown operation " + std::to_string(op));
+
+            p = p.then(operationPermutations[op]);
+        }
+
+        return p;
+    }
+
+    FaceletPermutation permutation;
+
+    PermutationKernel kernel;
+};
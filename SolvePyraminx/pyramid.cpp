@@ -1,7 +1,12 @@
 
 #include "pyramid.hpp"
+#include "permutation.hpp"
+#include "statemap.hpp"
+#include "idastar.hpp"
+#include "pyramidbatch.hpp"
+#include "surfacekernels.hpp"
 
-#include <unordered_map>
+#include <algorithm>
 
 const color RED = 0;
 const color GREEN = 1;
@@ -13,23 +18,6 @@ const unsigned int ALLGREEN = 0x15555;
 const unsigned int ALLBLUE = 0x2aaaa;
 const unsigned int ALLYELLOW = 0x3ffff;
 
-const std::list<Operation> allOperations =
-                { OP_NOOP
-                , OP_TURN_LEFT, OP_TURN_RIGHT, OP_RIGHT_CORNER_UP, OP_RIGHT_CORNER_DOWN, OP_LEFT_CORNER_UP, OP_LEFT_CORNER_DOWN
-                , OP_UPPER_RIGHT, OP_UPPER_LEFT, OP_RIGHT_UP, OP_RIGHT_DOWN, OP_LEFT_UP, OP_LEFT_DOWN, OP_BACK_CLOCKWISE, OP_BACK_COUNTER_CLOCKWISE
-                , OP_RIGHTEST_UP, OP_RIGHTEST_DOWN, OP_TOP_RIGHT, OP_TOP_LEFT};
-
-// because we want to avoid the reversed operations when solving one after another
-Operation reverseOp(const Operation &op);
-
-// use these moves in the process of solving
-static const std::list<Operation> solvingMoves = {
-    OP_UPPER_RIGHT, OP_UPPER_LEFT,
-    OP_RIGHT_UP, OP_RIGHT_DOWN,
-    OP_LEFT_UP, OP_LEFT_DOWN,
-    OP_BACK_CLOCKWISE, OP_BACK_COUNTER_CLOCKWISE
-};
-
 const size_t surface::hashWeights[] = {3, 5, 7, 5, 3, 7, 5, 7, 3};
 static const size_t colorWeights[] = {11, 13, 17, 19};
 
@@ -164,76 +152,68 @@ surface::surface(color c)
     }
 }
 
-surface::surface(std::string &s)
+/// parses the encoding of a surface (see pyramid(std::string_view)) into the bits of surface::elements, in a single pass
+static ParseError parseSurface(std::string_view s, unsigned int &elements)
 {
     elements = 0;
 
-    int i = 0;
-    int is = 0;
+    int tiles = 0;
+    color last = RED;
 
-    while(is < s.length())
+    for(char c: s)
     {
-        if(i == 9)
-            throw std::runtime_error("surface::surface(string): more than 9 tiles in the input string: " + s);
-
-        char c = s.at(is++);
-
-        if(isnumber(c))
+        if(c >= '0' && c <= '9')
         {
-            if(i == 0)
-                throw std::runtime_error("surface::surface(string): ill formatted string: begins with a number: " + s);
+            if(tiles == 0)
+                return PARSE_LEADING_COUNT;
 
-            c -= '0';
-
-            while(--c > 0)  // first decrement, because one color has been assigned for is-1 already
+            // the last color appears c times in all, so c-1 more times
+            for(int k = c - '0'; k > 1; k--)
             {
-                if(i == 9)
-                    throw std::runtime_error("surface::surface(string): more than 9 tiles in the input string: " + s);
-
-                // elements.at(i) = elements.at(i-1);
-                elements |= (0b11 & (elements >> 2));
-
-                i++;
-
-                if(i < 9)
-                    elements <<= 2;
+                if(tiles == 9)
+                    return PARSE_TOO_MANY_TILES;
 
+                elements = elements << 2 | last;
+                tiles++;
             }
+
+            continue;
         }
-        else
+
+        switch(c)
         {
-            switch(c)
-            {
-                case 'r':
-                    elements |= RED;
-                    break;
-                case 'g':
-                    elements |= GREEN;
-                    break;
-                case 'b':
-                    elements |= BLUE;
-                    break;
-                case 'y':
-                    elements |= YELLOW;
-                    break;
-                default:
-                {
-                    std::string errmsg = "surface::surface(string): illegal color character: ";
-                    errmsg += c;
-                    throw std::runtime_error(errmsg);
-                }
-            }
+            case 'r':
+                last = RED;
+                break;
+            case 'g':
+                last = GREEN;
+                break;
+            case 'b':
+                last = BLUE;
+                break;
+            case 'y':
+                last = YELLOW;
+                break;
+            default:
+                return PARSE_ILLEGAL_CHARACTER;
+        }
 
-            i++;
+        if(tiles == 9)
+            return PARSE_TOO_MANY_TILES;
 
-            if(i < 9)
-                elements <<= 2;
-            
-        }
+        elements = elements << 2 | last;
+        tiles++;
     }
 
-    if(i < 9)
-        throw std::runtime_error("surface::surface(string): input string encodes less than 9 tiles: " + s);
+    return tiles < 9 ? PARSE_TOO_FEW_TILES : PARSE_OK;
+}
+
+surface::surface(std::string_view s)
+{
+    ParseError e = parseSurface(s, elements);
+
+    if(e != PARSE_OK)
+        throw std::runtime_error("surface::surface(std::string_view): " + std::string(parseErrorToString(e)) + ": " + std::string(s));
 }
 
 bool surface::equal(const surface &s) const
@@ -303,114 +283,27 @@ bool surface::isSolvedCorners() const
 
 void surface::rotateClockwise()
 {
-    // code generated here for bit permutation: https://programming.sirrida.de/calcperm.php
-    // used the following mapping settings: MSB first, target bits: 1 0 11 10 3 2 5 4 17 16 13 12 15 14 7 6 9 8
-    unsigned int x = elements;
-
-    x = ((x & 0x0000000c) << 4)
-    | ((x & 0x000000c0) << 6)
-    | ((x & 0x00000303) << 8)
-    | ((x & 0x00000030) << 10)
-    | ((x & 0x00030000) >> 16)
-    | ((x & 0x00003000) >> 10)
-    | ((x & 0x00000c00) >> 6)
-    | ((x & 0x0000c000) >> 4);
-
-    elements = x;
+    elements = permuteSurface(elements, SURFACE_CLOCKWISE);
 }
 
 void surface::rotateCounterClockwise()
 {
-    // code generated here for bit permutation: https://programming.sirrida.de/calcperm.php
-    // used the following mapping settings: MSB first, source bits: 1 0 11 10 3 2 5 4 17 16 13 12 15 14 7 6 9 8
-    // (this is the same mapping as for clockwise, but with source instead of target bits!)
-    unsigned int x = elements;
-
-    x = ((x & 0x00000c00) << 4)
-    | ((x & 0x00000030) << 6)
-    | ((x & 0x0000000c) << 10)
-    | ((x & 0x00000003) << 16)
-    | ((x & 0x0000c000) >> 10)
-    | ((x & 0x00030300) >> 8)
-    | ((x & 0x00003000) >> 6)
-    | ((x & 0x000000c0) >> 4);
-
-    elements = x;
+    elements = permuteSurface(elements, SURFACE_COUNTER_CLOCKWISE);
 }
 
 void surface::rotateUpper(bool clockwise)
 {
-    unsigned int x = elements;
-
-    // code generated here for bit permutation: https://programming.sirrida.de/calcperm.php
-    if(clockwise)
-    {
-        // MSB first, target bits: 11 10 17 16 13 12 15 14 9 8 7 6 5 4 3 2 1 0
-        x = (x & 0x000033ff)
-        | ((x & 0x0000c000) << 2)
-        | ((x & 0x00000c00) << 4)
-        | ((x & 0x00030000) >> 6);
-    }
-    else
-    {
-        // MSB first, source bits: 11 10 17 16 13 12 15 14 9 8 7 6 5 4 3 2 1 0
-        x = (x & 0x000033ff)
-        | ((x & 0x00000c00) << 6)
-        | ((x & 0x0000c000) >> 4)
-        | ((x & 0x00030000) >> 2);
-    }
-
-    elements = x;
+    elements = permuteSurface(elements, clockwise ? SURFACE_UPPER_CLOCKWISE : SURFACE_UPPER_COUNTER_CLOCKWISE);
 }
 
 void surface::rotateLeft(bool clockwise)
 {
-    unsigned int x = elements;
-
-    // code generated here for bit permutation: https://programming.sirrida.de/calcperm.php
-    if(clockwise)
-    {
-        // MSB first, target bits: 17 16 5 4 13 12 11 10 15 14 7 6 9 8 3 2 1 0
-        x = (x & 0x00033ccf)
-        | ((x & 0x00000030) << 4)
-        | ((x & 0x00000300) << 6)
-        | ((x & 0x0000c000) >> 10);
-    }
-    else
-    {
-        // MSB first, source bits: 17 16 5 4 13 12 11 10 15 14 7 6 9 8 3 2 1 0
-        x = (x & 0x00033ccf)
-        | ((x & 0x00000030) << 10)
-        | ((x & 0x0000c000) >> 6)
-        | ((x & 0x00000300) >> 4);
-    }
-
-    elements = x;
+    elements = permuteSurface(elements, clockwise ? SURFACE_LEFT_CLOCKWISE : SURFACE_LEFT_COUNTER_CLOCKWISE);
 }
 
 void surface::rotateRight(bool clockwise)
 {
-    unsigned int x = elements;
-
-    // code generated here for bit permutation: https://programming.sirrida.de/calcperm.php
-    if(clockwise)
-    {
-        // MSB first, target bits: 17 16 15 14 13 12 1 0 9 8 7 6 11 10 3 2 5 4
-        x = (x & 0x0003f3cc)
-        | ((x & 0x00000003) << 4)
-        | ((x & 0x00000030) << 6)
-        | ((x & 0x00000c00) >> 10);
-    }
-    else
-    {
-        // MSB first, source bits: 17 16 15 14 13 12 1 0 9 8 7 6 11 10 3 2 5 4
-        x = (x & 0x0003f3cc)
-        | ((x & 0x00000003) << 10)
-        | ((x & 0x00000c00) >> 6)
-        | ((x & 0x00000030) >> 4);
-    }
-
-    elements = x;
+    elements = permuteSurface(elements, clockwise ? SURFACE_RIGHT_CLOCKWISE : SURFACE_RIGHT_COUNTER_CLOCKWISE);
 }
 
 void surface::setByMask(unsigned int mask, unsigned int selection)
@@ -439,6 +332,16 @@ unsigned int surface::getColors() const
     return elements;
 }
 
+color surface::getColor(int i) const
+{
+    return (elements >> 2*(8-i)) & 0b11;
+}
+
+void surface::setColor(int i, color c)
+{
+    setByMask(0b11 << 2*(8-i), c << 2*(8-i));
+}
+
 color surface::getTop() const
 {
     return elements >> 16;
@@ -480,68 +383,94 @@ front(surface(frontColor)), left(surface(leftColor)), right(surface(rightColor))
     
 }
 
-pyramid::pyramid(std::string sin) : front(0), right(0), left(0), bottom(0)
+pyramid::pyramid(std::string_view s) : front(0), left(0), right(0), bottom(0)
 {
-    std::string s(sin);
-    char delimiter = ',';
+    ParseError e = parsePyramid(s, *this);
 
-    size_t pos = 0;
-    std::string tokens[4];
-    int t = 0;
+    if(e != PARSE_OK)
+        throw std::runtime_error("pyramid::pyramid(std::string_view): " + std::string(parseErrorToString(e)) + ": " + std::string(s));
+}
+
+ParseError parsePyramid(std::string_view s, pyramid &p)
+{
+    unsigned int bits[4];
 
-    while(s.size() > 0)
+    for(int f=0; f<4; f++)
     {
-        if(t == 4)
-            throw std::runtime_error("pyramid::pyramid(std::string): illegal input string has more than 4 surfaces: " + sin);
+        size_t comma = s.find(',');
 
-        pos = s.find(delimiter);
-        tokens[t++] = s.substr(0, pos);
+        // the last surface must not be followed by a comma, and all others must be
+        if((comma == std::string_view::npos) != (f == 3))
+            return PARSE_SURFACE_COUNT;
 
-        if(pos == std::string::npos)
-            break;
-        else
-            s.erase(0, pos + 1);
+        ParseError e = parseSurface(s.substr(0, comma), bits[f]);
+
+        if(e != PARSE_OK)
+            return e;
+
+        s.remove_prefix(f == 3 ? s.size() : comma + 1);
     }
 
-    if(t != 4)
-        throw std::runtime_error("pyramid::pyramid(std::string): illegal input string has less than 4 surfaces: " + sin);
+    p.setBits(bits);
 
-    front = surface(tokens[0]);
-    right = surface(tokens[1]);
-    left = surface(tokens[2]);
-    bottom = surface(tokens[3]);
+    return PARSE_OK;
 }
 
-bool pyramid::equal(const pyramid &p) const
+size_t parsePyramids(std::string_view buffer, std::vector<pyramid> &ps, std::vector<ParseError> &errors)
 {
-    return p.front == front && p.right == right && p.left == left && p.bottom == bottom;
+    size_t parsed = 0;
+
+    while(!buffer.empty())
+    {
+        size_t end = buffer.find('\n');
+        std::string_view line = buffer.substr(0, end);
+
+        buffer.remove_prefix(end == std::string_view::npos ? buffer.size() : end + 1);
+
+        if(!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+        if(line.empty())
+            continue;
+
+        ps.emplace_back(RED, RED, RED, RED);
+        errors.push_back(parsePyramid(line, ps.back()));
+
+        parsed += errors.back() == PARSE_OK;
+    }
+
+    return parsed;
 }
 
-bool pyramid::equivalent(const pyramid &p) const
+const char *parseErrorToString(ParseError e)
 {
-    if(hashPyramid::computeHash(*this) != hashPyramid::computeHash(p))
-        return false;
-    
-    // there was no obvious difference, so now we must go through all orientations and search if they are equal
-    pyramid pp(p);
-    
-    for(int i=0; i<4; i++)
+    switch(e)
     {
-        for(int j=0; j<3; j++)
-        {
-            if(equal(pp))
-                return true;
-            
-            pp.turnLeft();
-        }
-
-        if(i < 3)
-            pp.rotateRightCornerUp();
-        else
-            pp.rotateLeftCornerUp();
+        case PARSE_OK:
+            return "no error";
+        case PARSE_SURFACE_COUNT:
+            return "the input does not have exactly 4 surfaces separated by commas";
+        case PARSE_LEADING_COUNT:
+            return "a surface begins with a number";
+        case PARSE_TOO_MANY_TILES:
+            return "a surface has more than 9 tiles";
+        case PARSE_TOO_FEW_TILES:
+            return "a surface has less than 9 tiles";
+        case PARSE_ILLEGAL_CHARACTER:
+            return "illegal color character";
+        default:
+            return "unknown parse error";
     }
+}
 
-    return false;
+bool pyramid::equal(const pyramid &p) const
+{
+    return p.front == front && p.right == right && p.left == left && p.bottom == bottom;
+}
+
+bool pyramid::equivalent(const pyramid &p) const
+{
+    return canonical().equal(p.canonical());
 }
 
 bool pyramid::operator==(const pyramid &p) const
@@ -620,307 +549,755 @@ std::string pyramid::storageString() const
     return s;
 }
 
-void pyramid::turnLeft()
+color pyramid::getColor(Face f, int i) const
 {
-    surface s = front;
-    front = right;
-    right = left;
-    left = s;
+    return at(f).getColor(i);
+}
 
-    bottom.rotateCounterClockwise();
+void pyramid::setColor(Face f, int i, color c)
+{
+    at(f).setColor(i, c);
 }
 
-void pyramid::turnRight()
+surface &pyramid::at(Face f)
 {
-    surface s = front;
-    front = left;
-    left = right;
-    right = s;
+    switch(f)
+    {
+        case FACE_FRONT: return front;
+        case FACE_RIGHT: return right;
+        case FACE_LEFT: return left;
+        case FACE_BOTTOM: return bottom;
+        default:
+            throw std::runtime_error("pyramid::at(): unknown face " + std::to_string(f));
+    }
+}
 
-    bottom.rotateClockwise();
+const surface &pyramid::at(Face f) const
+{
+    return const_cast<pyramid*>(this)->at(f);
 }
 
-void pyramid::rotateRightCornerUp()
+/// a single tile, addressed by its surface and its index on that surface
+struct facelet
 {
-    front.rotateCounterClockwise();
-    right.rotateClockwise();
-    bottom.rotateClockwise();
+    Face face;
+    int tile;
+};
+
+/**
+ * The six edges, each given by its two tiles. The position of an edge is the index in this array.
+ * An edge is correctly oriented if its first tile shows the color of the surface of the first tile of its home position.
+ */
+static const facelet edgeFacelets[6][2] = {
+    {{FACE_FRONT, 1}, {FACE_LEFT, 3}},
+    {{FACE_FRONT, 3}, {FACE_RIGHT, 1}},
+    {{FACE_RIGHT, 3}, {FACE_LEFT, 1}},
+    {{FACE_FRONT, 6}, {FACE_BOTTOM, 6}},
+    {{FACE_RIGHT, 6}, {FACE_BOTTOM, 1}},
+    {{FACE_LEFT, 6}, {FACE_BOTTOM, 3}}
+};
+
+/**
+ * The axial centers of the top, right, left and back corner, in the cyclic order in which the layer moves carry them.
+ * The tips lie on the same surfaces, and the corners are opposite to the surfaces in centerOpposite.
+ */
+static const facelet centerFacelets[4][3] = {
+    {{FACE_FRONT, 2}, {FACE_RIGHT, 2}, {FACE_LEFT, 2}},
+    {{FACE_FRONT, 7}, {FACE_RIGHT, 5}, {FACE_BOTTOM, 5}},
+    {{FACE_FRONT, 5}, {FACE_LEFT, 7}, {FACE_BOTTOM, 7}},
+    {{FACE_RIGHT, 7}, {FACE_BOTTOM, 2}, {FACE_LEFT, 5}}
+};
+
+static const facelet tipFacelets[4][3] = {
+    {{FACE_FRONT, 0}, {FACE_RIGHT, 0}, {FACE_LEFT, 0}},
+    {{FACE_FRONT, 8}, {FACE_RIGHT, 4}, {FACE_BOTTOM, 4}},
+    {{FACE_FRONT, 4}, {FACE_LEFT, 8}, {FACE_BOTTOM, 8}},
+    {{FACE_RIGHT, 8}, {FACE_BOTTOM, 0}, {FACE_LEFT, 4}}
+};
+
+static const Face centerOpposite[4] = {FACE_BOTTOM, FACE_LEFT, FACE_RIGHT, FACE_FRONT};
+
+/// the colors of the surfaces of the solved pyramid "b9,g9,y9,r9", indexed by Face.
+static const color referenceColors[4] = {BLUE, GREEN, YELLOW, RED};
 
-    surface s = front;
-    front = bottom;
-    bottom = left;
-    left = s;
+/// deduce the color each surface has when solved: it is the one color that the opposite axial center does not show.
+static void surfaceColors(const pyramid &p, color colors[4])
+{
+    for(int c=0; c<4; c++)
+    {
+        color sum = 0;
+
+        for(const facelet &f: centerFacelets[c])
+            sum += p.getColor(f.face, f.tile);
+
+        colors[centerOpposite[c]] = RED + GREEN + BLUE + YELLOW - sum;
+    }
 }
 
-void pyramid::rotateRightCornerDown()
+/// checks that the colors from surfaceColors() are RED, GREEN, BLUE and YELLOW in some order, which they are not if the centers are broken
+static bool validSurfaceColors(const color colors[4])
 {
-    front.rotateCounterClockwise();
-    right.rotateCounterClockwise();
-    left.rotateClockwise();
+    int seen = 0;
+
+    for(int f=0; f<4; f++)
+    {
+        // the difference in surfaceColors() wraps around if the center colors add up to more than all colors
+        if(colors[f] > YELLOW)
+            return false;
+
+        seen |= 1 << colors[f];
+    }
 
-    surface s = front;
-    front = left;
-    left = bottom;
-    bottom = s;
+    return seen == 0b1111;
 }
 
-void pyramid::rotateLeftCornerUp()
+// in the order of tipFacelets
+const Operation tipMoves[4] = {OP_TOP_RIGHT, OP_RIGHTEST_UP, OP_LEFTEST_UP, OP_BACKEST_CLOCKWISE};
+
+/// how far tip c of p is twisted against its axial center: 0 if it is aligned, otherwise the number of tipMoves[c] that align it
+static int tipTwist(const pyramid &p, int c)
 {
-    front.rotateClockwise();
-    left.rotateCounterClockwise();
-    bottom.rotateCounterClockwise();
+    color c0 = p.getColor(tipFacelets[c][0].face, tipFacelets[c][0].tile);
+
+    int t = 0;
+    while(t < 2 && p.getColor(centerFacelets[c][t].face, centerFacelets[c][t].tile) != c0)
+        t++;
 
-    surface s = front;
-    front = bottom;
-    bottom = right;
-    right = s;
+    return t;
 }
 
-void pyramid::rotateLeftCornerDown()
+int pyramid::tipTwists() const
 {
-    // TODO: implement properly
-    rotateLeftCornerUp();
-    rotateLeftCornerUp();
+    int twists = 0;
+
+    for(int c=0; c<4; c++)
+        twists = twists * 3 + tipTwist(*this, c);
+
+    return twists;
 }
 
-void pyramid::rotateUpperRight()
+bool isSolution(const pyramid &p, const std::list<Operation> &moves)
 {
-    surface s(front);
-    front.setUpper(left.getColors());
-    left.setUpper(right.getColors());
-    right.setUpper(s.getColors());
+    pyramid q(p);
+
+    for(Operation op: moves)
+        executeOperation(q, op);
+
+    return q.isSolved();
 }
 
-void pyramid::rotateUpperLeft()
+void solveTips(const pyramid &p, std::list<Operation> &moves)
 {
-    surface s(front);
-    front.setUpper(right.getColors());
-    right.setUpper(left.getColors());
-    left.setUpper(s.getColors());
+    for(int c=0; c<4; c++)
+    {
+        int t = tipTwist(p, c);
+
+        if(t == 1)
+            moves.push_back(tipMoves[c]);
+        else if(t == 2)
+            moves.push_back(reverseOp(tipMoves[c]));
+    }
 }
 
-void pyramid::rotateRightUp()
+size_t pyramid::rank() const
 {
-    surface s(front);
+    color colors[4];
+    surfaceColors(*this, colors);
 
-    bottom.rotateCounterClockwise();
-    front.setRight(bottom.getColors());
-    bottom.rotateClockwise();
-    
-    bottom.setLeft(right.getColors());
+    // find the piece that sits at each edge position, and how it is flipped
+    int perm[6];
+    int orientation = 0;
+
+    for(int pos=0; pos<6; pos++)
+    {
+        color c0 = getColor(edgeFacelets[pos][0].face, edgeFacelets[pos][0].tile);
+        color c1 = getColor(edgeFacelets[pos][1].face, edgeFacelets[pos][1].tile);
+
+        perm[pos] = 0;
+
+        for(int e=0; e<6; e++)
+        {
+            color h0 = colors[edgeFacelets[e][0].face];
+            color h1 = colors[edgeFacelets[e][1].face];
+
+            if((c0 == h0 && c1 == h1) || (c0 == h1 && c1 == h0))
+            {
+                perm[pos] = e;
+
+                // the orientation of the last edge follows from the others
+                if(pos < 5 && c0 != h0)
+                    orientation |= 1 << pos;
 
-    s.rotateClockwise();
-    right.setLeft(s.getColors());
+                break;
+            }
+        }
+    }
+
+    // lehmer code of the permutation. The last two digits are determined by the parity, which is always even.
+    size_t permutation = 0;
+
+    for(int i=0; i<4; i++)
+    {
+        int smaller = 0;
+
+        for(int j=i+1; j<6; j++)
+            if(perm[j] < perm[i])
+                smaller++;
+
+        permutation = permutation * (6-i) + smaller;
+    }
+
+    // the twist of each center is the position in its cycle whose color appears on its first tile
+    size_t twists = 0;
+
+    for(int c=0; c<4; c++)
+    {
+        color c0 = getColor(centerFacelets[c][0].face, centerFacelets[c][0].tile);
+
+        int t = 0;
+        while(t < 2 && colors[centerFacelets[c][t].face] != c0)
+            t++;
+
+        twists = twists * 3 + t;
+    }
+
+    return (permutation * 32 + orientation) * 81 + twists;
 }
 
-void pyramid::rotateRightDown()
+uint64_t pyramid::coreKey() const
+{
+    uint64_t key = 0;
+
+    for(const surface *s: {&front, &right, &left, &bottom})
+    {
+        // tiles 1 to 3 are in bits 15 to 10, tiles 5 to 7 in bits 7 to 2
+        unsigned int e = s->getColors();
+        key = (key << 12) | ((e >> 4) & 0xfc0) | ((e >> 2) & 0x3f);
+    }
+
+    return key;
+}
+
+pyramid pyramid::unrank(size_t r)
+{
+    pyramid p(referenceColors[FACE_FRONT], referenceColors[FACE_LEFT], referenceColors[FACE_RIGHT], referenceColors[FACE_BOTTOM]);
+
+    size_t twists = r % 81;
+    r /= 81;
+    int orientation = r % 32;
+    size_t permutation = r / 32;
+
+    for(int c=3; c>=0; c--)
+    {
+        int t = twists % 3;
+        twists /= 3;
+
+        for(int k=0; k<3; k++)
+        {
+            color col = referenceColors[centerFacelets[c][(k+t) % 3].face];
+            p.setColor(centerFacelets[c][k].face, centerFacelets[c][k].tile, col);
+            p.setColor(tipFacelets[c][k].face, tipFacelets[c][k].tile, col);
+        }
+    }
+
+    // decode the lehmer code, and complete it with the two digits that make the permutation even
+    int digits[6] = {0, 0, 0, 0, 0, 0};
+    int parity = 0;
+
+    for(int i=3; i>=0; i--)
+    {
+        digits[i] = permutation % (6-i);
+        permutation /= 6-i;
+        parity += digits[i];
+    }
+
+    digits[4] = parity % 2;
+
+    int perm[6];
+    bool used[6] = {false, false, false, false, false, false};
+
+    for(int i=0; i<6; i++)
+    {
+        int e = 0;
+
+        for(int skip = digits[i]; used[e] || skip > 0; e++)
+            if(!used[e])
+                skip--;
+
+        used[e] = true;
+        perm[i] = e;
+    }
+
+    int flips = 0;
+
+    for(int pos=0; pos<6; pos++)
+    {
+        bool flipped = pos < 5 ? (orientation >> pos) & 1 : flips % 2;
+        flips += flipped;
+
+        color h0 = referenceColors[edgeFacelets[perm[pos]][0].face];
+        color h1 = referenceColors[edgeFacelets[perm[pos]][1].face];
+
+        if(flipped)
+            std::swap(h0, h1);
+
+        p.setColor(edgeFacelets[pos][0].face, edgeFacelets[pos][0].tile, h0);
+        p.setColor(edgeFacelets[pos][1].face, edgeFacelets[pos][1].tile, h1);
+    }
+
+    return p;
+}
+
+// every operation runs as one kernel compiled from its tile permutation, see permutation.hpp
+
+template<size_t... I>
+static constexpr std::array<void(*)(pyramid&), 12> rotationKernels(std::index_sequence<I...>)
+{
+    return {static_cast<void(*)(pyramid&)>(applyKernel<PermutationKernel(wholeRotations[I])>)...};
+}
+
+/// the kernel of each of the whole rotations, indexed like wholeRotations
+static constexpr std::array<void(*)(pyramid&), 12> rotateWhole = rotationKernels(std::make_index_sequence<12>());
+
+/// canonicalRotation[r][b] is the whole rotation that moves surface r to the bottom and surface b to the front
+static constexpr std::array<std::array<int, 4>, 4> canonicalRotation = []()
+{
+    std::array<std::array<int, 4>, 4> table{};
+
+    for(int k=0; k<12; k++)
+    {
+        // the position that surface f ends up at, found by following its top tile
+        auto destination = [k](int f){ return wholeRotations[k].target[9*f] / 9; };
+
+        for(int r=0; r<4; r++)
+            for(int b=0; b<4; b++)
+                if(destination(r) == FACE_BOTTOM && destination(b) == FACE_FRONT)
+                    table[r][b] = k;
+    }
+
+    return table;
+}();
+
+pyramid pyramid::canonical() const
+{
+    color colors[4];
+    surfaceColors(*this, colors);
+
+    int redFace = -1;
+    int blueFace = -1;
+    int seen = 0;
+
+    for(int f=0; f<4; f++)
+    {
+        // with broken centers, the sum of the center colors may exceed the sum of all colors, and the difference wraps around
+        if(colors[f] > YELLOW)
+        {
+            seen = 0;
+            break;
+        }
+
+        seen |= 1 << colors[f];
+
+        if(colors[f] == RED)
+            redFace = f;
+        else if(colors[f] == BLUE)
+            blueFace = f;
+    }
+
+    pyramid p(*this);
+
+    if(seen == 0b1111)
+    {
+        rotateWhole[canonicalRotation[redFace][blueFace]](p);
+        return p;
+    }
+
+    // the centers are broken, so fall back to the rotation with the smallest bitfields
+    pyramid best(p);
+    unsigned int bestBits[4];
+    best.getBits(bestBits);
+
+    for(int k=1; k<12; k++)
+    {
+        pyramid q(p);
+        rotateWhole[k](q);
+
+        unsigned int bits[4];
+        q.getBits(bits);
+
+        if(std::lexicographical_compare(bits, bits + 4, bestBits, bestBits + 4))
+        {
+            best = q;
+            best.getBits(bestBits);
+        }
+    }
+
+    return best;
+}
+
+CanonicalPyramid::CanonicalPyramid(const pyramid &p)
+{
+    unsigned int bits[4];
+    p.canonical().getBits(bits);
+
+    sides = uint64_t(bits[FACE_FRONT]) | (uint64_t(bits[FACE_RIGHT]) << 18) | (uint64_t(bits[FACE_LEFT]) << 36);
+    bottom = bits[FACE_BOTTOM];
+}
+
+pyramid CanonicalPyramid::toPyramid() const
+{
+    const unsigned int mask = 0x3ffff;
+    const unsigned int bits[4] = {unsigned(sides) & mask, unsigned(sides >> 18) & mask, unsigned(sides >> 36) & mask, bottom};
+
+    pyramid p(RED, RED, RED, RED);
+    p.setBits(bits);
+
+    return p;
+}
+
+void pyramid::turnLeft()
+{
+    applyOperation<OP_TURN_LEFT>(*this);
+}
+
+void pyramid::turnRight()
+{
+    applyOperation<OP_TURN_RIGHT>(*this);
+}
+
+void pyramid::rotateRightCornerUp()
+{
+    applyOperation<OP_RIGHT_CORNER_UP>(*this);
+}
+
+void pyramid::rotateRightCornerDown()
 {
-    surface s(front);
+    applyOperation<OP_RIGHT_CORNER_DOWN>(*this);
+}
+
+void pyramid::rotateLeftCornerUp()
+{
+    applyOperation<OP_LEFT_CORNER_UP>(*this);
+}
+
+void pyramid::rotateLeftCornerDown()
+{
+    applyOperation<OP_LEFT_CORNER_DOWN>(*this);
+}
+
+void pyramid::rotateUpperRight()
+{
+    applyOperation<OP_UPPER_RIGHT>(*this);
+}
 
-    right.rotateCounterClockwise();
-    front.setRight(right.getColors());
-    right.rotateClockwise();
+void pyramid::rotateUpperLeft()
+{
+    applyOperation<OP_UPPER_LEFT>(*this);
+}
 
-    right.setLeft(bottom.getColors());
+void pyramid::rotateRightUp()
+{
+    applyOperation<OP_RIGHT_UP>(*this);
+}
 
-    s.rotateClockwise();
-    bottom.setLeft(s.getColors());
+void pyramid::rotateRightDown()
+{
+    applyOperation<OP_RIGHT_DOWN>(*this);
 }
 
 void pyramid::rotateLeftUp()
 {
-    // TODO: implement this properly
-    turnRight();
-    rotateRightDown();
-    turnLeft();
+    applyOperation<OP_LEFT_UP>(*this);
 }
 
 void pyramid::rotateLeftDown()
 {
-    // TODO: implement this properly
-    turnRight();
-    rotateRightUp();
-    turnLeft();
+    applyOperation<OP_LEFT_DOWN>(*this);
 }
 
 void pyramid::rotateBackClockwise()
 {
-    // TODO: implement this properly
-    turnLeft();
-    rotateRightDown();
-    turnRight();
+    applyOperation<OP_BACK_CLOCKWISE>(*this);
 }
 
 void pyramid::rotateBackCounterClockwise()
 {
-    // TODO: implement this properly
-    turnLeft();
-    rotateRightUp();
-    turnRight();
+    applyOperation<OP_BACK_COUNTER_CLOCKWISE>(*this);
 }
 
 void pyramid::rotateRightestUp()
 {
-    color c = front.getRightest();
-    front.setRightest(bottom.getLeftest());
-    bottom.setLeftest(right.getLeftest());
-    right.setLeftest(c);
+    applyOperation<OP_RIGHTEST_UP>(*this);
 }
 
 void pyramid::rotateRightestDown()
 {
-    color c = front.getRightest();
-    front.setRightest(right.getLeftest());
-    right.setLeftest(bottom.getLeftest());
-    bottom.setLeftest(c);
+    applyOperation<OP_RIGHTEST_DOWN>(*this);
 }
 
 void pyramid::rotateTopRight()
 {
-    surface s(front);
-    front.setTop(left.getTop());
-    left.setTop(right.getTop());
-    right.setTop(s.getTop());
+    applyOperation<OP_TOP_RIGHT>(*this);
 }
 
 void pyramid::rotateTopLeft()
 {
-    surface s(front);
-    front.setTop(right.getTop());
-    right.setTop(left.getTop());
-    left.setTop(s.getTop());
+    applyOperation<OP_TOP_LEFT>(*this);
 }
 
-bool solve(pyramid &start, std::list<Operation> &moves)
+void pyramid::rotateLeftestUp()
 {
-    if(start.isSolved())
-        return true;
+    applyOperation<OP_LEFTEST_UP>(*this);
+}
 
-    std::list<pyramid> data = {start};
+void pyramid::rotateLeftestDown()
+{
+    applyOperation<OP_LEFTEST_DOWN>(*this);
+}
 
-    std::unordered_map<const pyramid*, std::pair<pyramid*, Operation>> pred = {{&data.front(), {nullptr, OP_NOOP}}};
-    
-    std::list<pyramid*> q = {&data.front()};
+void pyramid::rotateBackestClockwise()
+{
+    applyOperation<OP_BACKEST_CLOCKWISE>(*this);
+}
+
+void pyramid::rotateBackestCounterClockwise()
+{
+    applyOperation<OP_BACKEST_COUNTER_CLOCKWISE>(*this);
+}
+
+/// a pyramid found by a search, with the index of its predecessor and the move that led to it
+struct searchNode
+{
+    pyramid state;
+    uint32_t pred;
+    Operation op;
+};
+
+/// the number of moves from the root of a search to data[i]
+static size_t searchDepth(const std::vector<searchNode> &data, size_t i)
+{
+    size_t depth = 0;
+
+    for(; i != 0; i = data[i].pred)
+        depth++;
+
+    return depth;
+}
+
+static bool solveBreadthFirst(pyramid &start, std::list<Operation> &moves)
+{
+    // every pyramid that was found, in the order in which it was found. This is also the bfs queue.
+    std::vector<searchNode> data = {{start, 0, OP_NOOP}};
 
-    pyramid *end = nullptr;
+    // the index in data of every pyramid that was found, by its tiles apart from the tips
+    StateMap seen;
+    seen.insert(start.coreKey(), 0);
 
-    while(!q.empty() && end == nullptr)
+    size_t end = 0;
+
+    for(size_t head=0; head<data.size() && end == 0; head++)
     {
-        pyramid *p = q.front();
-        q.pop_front();
+        const Operation lastOpReversed = reverseOp(data[head].op);
+
+        // a copy, since data grows while the neighbors are generated
+        const pyramid state(data[head].state);
 
-        Operation lastOpReversed = reverseOp(pred.at(p).second);
-        
         // generate all neighbors
-        for(auto &op: solvingMoves)
+        forEachSolvingMove(state, [&](Operation op, const pyramid &p)
         {
             if(op == lastOpReversed)            // this would be very counter-productive.
-                continue;
+                return false;
 
-            data.push_back(pyramid(*p));
-            pyramid *pp = &data.back();
+            if(!seen.insert(p.coreKey(), data.size()))
+                return false;
 
-            executeOperation(data.back(), op);
+            data.push_back({p, uint32_t(head), op});
 
-            if(!pred.contains(pp))
+            if(p.isSolvedButCorners())
             {
-                pred.insert({pp, {p, op}});
-                q.push_back(pp);
+                end = data.size() - 1;
+                return true;
             }
 
-            if(data.back().isSolvedButCorners())
+            return false;
+        });
+    }
+
+    if(end == 0)
+        return false;
+
+    auto it = moves.end();
+
+    for(size_t i = end; i != 0; i = data[i].pred)
+        it = moves.insert(it, data[i].op);
+
+    return true;
+}
+
+/// the number of pyramids of a layer that solveBidirectional() moves at once
+static const size_t SEARCH_CHUNK = 256;
+
+/// one of the two searches of solveBidirectional()
+struct searchTree
+{
+    std::vector<searchNode> data;
+
+    StateMap seen;
+
+    /// data[layer] up to the end is the last layer that was found
+    size_t layer;
+
+    searchTree(const pyramid &root) : data{{root, 0, OP_NOOP}}, layer(0)
+    {
+        seen.insert(root.coreKey(), 0);
+    }
+
+    size_t frontier() const
+    {
+        return data.size() - layer;
+    }
+};
+
+static bool solveBidirectional(pyramid &start, std::list<Operation> &moves)
+{
+    color colors[4];
+    surfaceColors(start, colors);
+
+    // the backward search starts from the solved pyramid in these colors, which does not exist if the centers are broken
+    if(!validSurfaceColors(colors))
+        return false;
+
+    searchTree forward(start);
+    searchTree backward(pyramid(colors[FACE_FRONT], colors[FACE_LEFT], colors[FACE_RIGHT], colors[FACE_BOTTOM]));
+
+    PyramidBatch states(SEARCH_CHUNK);
+    PyramidBatch moved(SEARCH_CHUNK);
+
+    // the shortest connection found so far, by the indices of the meeting point in both searches
+    size_t best = SIZE_MAX;
+    size_t meetForward = 0;
+    size_t meetBackward = 0;
+
+    while(best == SIZE_MAX)
+    {
+        // grow the smaller search by one whole layer, and take the shortest connection within it
+        const bool growForward = forward.frontier() <= backward.frontier();
+        searchTree &t = growForward ? forward : backward;
+        const searchTree &other = growForward ? backward : forward;
+
+        const size_t layerEnd = t.data.size();
+
+        if(t.layer == layerEnd)             // the search ran out of pyramids without meeting the other one
+            return false;
+
+        // the order in which a layer is expanded does not matter, so it is expanded in chunks of pyramids,
+        // and each operation is applied to a whole chunk at once
+        for(size_t chunk=t.layer; chunk<layerEnd; chunk+=SEARCH_CHUNK)
+        {
+            const size_t chunkEnd = std::min(layerEnd, chunk + SEARCH_CHUNK);
+
+            states.clear();
+
+            for(size_t i=chunk; i<chunkEnd; i++)
+                states.push_back(t.data[i].state);
+
+            for(Operation op: solvingMoves)
             {
-                end = pp;
-                break;
+                moved = states;
+                moved.apply(op);
+
+                for(size_t i=chunk; i<chunkEnd; i++)
+                {
+                    if(op == reverseOp(t.data[i].op))
+                        continue;
+
+                    const pyramid p = moved.at(i - chunk);
+
+                    uint64_t key = p.coreKey();
+
+                    if(!t.seen.insert(key, t.data.size()))
+                        continue;
+
+                    t.data.push_back({p, uint32_t(i), op});
+
+                    uint32_t j = other.seen.find(key);
+
+                    if(j != StateMap::NOT_FOUND)
+                    {
+                        size_t length = searchDepth(t.data, t.data.size() - 1) + searchDepth(other.data, j);
+
+                        if(length < best)
+                        {
+                            best = length;
+                            meetForward = growForward ? t.data.size() - 1 : j;
+                            meetBackward = growForward ? j : t.data.size() - 1;
+                        }
+                    }
+                }
             }
         }
+
+        t.layer = layerEnd;
     }
 
-    if(end != nullptr)
-    {
-        pyramid *p = end;
+    // the moves from the start to the meeting point, then the reversed moves from the meeting point back to the solved pyramid
+    std::list<Operation> tail;
 
-        while(true)
-        {
-            auto &pnext = pred.at(p);
-            p = pnext.first;
+    for(size_t i = meetBackward; i != 0; i = backward.data[i].pred)
+        tail.push_back(reverseOp(backward.data[i].op));
 
-            if(p != nullptr)
-                moves.push_front(pnext.second);
-            else
+    auto it = moves.end();
+
+    for(size_t i = meetForward; i != 0; i = forward.data[i].pred)
+        it = moves.insert(it, forward.data[i].op);
+
+    moves.splice(moves.end(), tail);
+
+    return true;
+}
+
+bool solve(pyramid &start, std::list<Operation> &moves, SolveMode mode)
+{
+    std::list<Operation> solution;
+    bool found = true;
+
+    if(!start.isSolvedButCorners())
+    {
+        switch(mode)
+        {
+            case SOLVE_BFS:
+                found = solveBreadthFirst(start, solution);
+                break;
+            case SOLVE_BIDIRECTIONAL:
+                found = solveBidirectional(start, solution);
                 break;
+            case SOLVE_IDA_STAR:
+                found = solveIDAStar(start, solution);
+                break;
+            default:
+                throw std::runtime_error("solve(): unknown mode " + std::to_string(mode));
         }
-
-        return true;
     }
-    else
+
+    if(!found)
+        return false;
+
+    solveTips(start, solution);
+
+    if(!isSolution(start, solution))
         return false;
+
+    moves.splice(moves.end(), solution);
+    return true;
 }
 
 void executeOperation(pyramid &p, Operation op)
 {
-    switch(op)
-    {
-        case OP_NOOP:
-            break;
-        case OP_TURN_LEFT:
-            p.turnLeft();
-            break;
-        case OP_TURN_RIGHT:
-            p.turnRight();
-            break;
-        case OP_RIGHT_CORNER_UP:
-            p.rotateRightCornerUp();
-            break;
-        case OP_RIGHT_CORNER_DOWN:
-            p.rotateRightCornerDown();
-            break;
-        case OP_LEFT_CORNER_UP:
-            p.rotateLeftCornerUp();
-            break;
-        case OP_LEFT_CORNER_DOWN:
-            p.rotateLeftCornerDown();
-            break;
-        case OP_UPPER_RIGHT:
-            p.rotateUpperRight();
-            break;
-        case OP_UPPER_LEFT:
-            p.rotateUpperLeft();
-            break;
-        case OP_RIGHT_UP:
-            p.rotateRightUp();
-            break;
-        case OP_RIGHT_DOWN:
-            p.rotateRightDown();
-            break;
-        case OP_LEFT_UP:
-            p.rotateLeftUp();
-            break;
-        case OP_LEFT_DOWN:
-            p.rotateLeftDown();
-            break;
-        case OP_BACK_CLOCKWISE:
-            p.rotateBackClockwise();
-            break;
-        case OP_BACK_COUNTER_CLOCKWISE:
-            p.rotateBackCounterClockwise();
-            break;
-        case OP_RIGHTEST_UP:
-            p.rotateRightestUp();
-            break;
-        case OP_RIGHTEST_DOWN:
-            p.rotateRightestDown();
-            break;
-        case OP_TOP_LEFT:
-            p.rotateTopLeft();
-            break;
-        case OP_TOP_RIGHT:
-            p.rotateTopRight();
-            break;
-        default:
-            throw std::runtime_error("executeOperation(): unknown operation: " + operationToString(op));
-    }   
-    
+    if(op < 0 || op >= OPERATION_COUNT)
+        throw std::runtime_error("executeOperation(): unknown operation: " + operationToString(op));
+
+    operationFunctions[op](p);
+
     #if DEBUG
     std::cout << "Executed operation: " << op << "()." << std::endl;
     #endif
@@ -942,6 +1319,12 @@ std::string operationToString(const Operation &op)
         case OP_RIGHT_CORNER_DOWN:
             return "Turn the right corner downwards.";
             break;
+        case OP_LEFT_CORNER_UP:
+            return "Turn the left corner upwards.";
+            break;
+        case OP_LEFT_CORNER_DOWN:
+            return "Turn the left corner downwards.";
+            break;
         case OP_UPPER_RIGHT:
             return "Rotate the upper section towards the right.";
             break;
@@ -978,6 +1361,18 @@ std::string operationToString(const Operation &op)
         case OP_TOP_RIGHT:
             return "Rotate the top corner right.";
             break;
+        case OP_LEFTEST_UP:
+            return "Rotate the left corner upwards.";
+            break;
+        case OP_LEFTEST_DOWN:
+            return "Rotate the left corner downwards.";
+            break;
+        case OP_BACKEST_CLOCKWISE:
+            return "Rotate the back corner clockwise from the front perspective.";
+            break;
+        case OP_BACKEST_COUNTER_CLOCKWISE:
+            return "Rotate the back corner counter-clockwise from the front perspective.";
+            break;
         case OP_NOOP:
             return "Don't do anything.";
         default:
@@ -1001,6 +1396,12 @@ Operation reverseOp(const Operation &op)
         case OP_RIGHT_CORNER_DOWN:
             return OP_RIGHT_CORNER_UP;
             break;
+        case OP_LEFT_CORNER_UP:
+            return OP_LEFT_CORNER_DOWN;
+            break;
+        case OP_LEFT_CORNER_DOWN:
+            return OP_LEFT_CORNER_UP;
+            break;
         case OP_UPPER_RIGHT:
             return OP_UPPER_LEFT;
             break;
@@ -1037,6 +1438,18 @@ Operation reverseOp(const Operation &op)
         case OP_TOP_RIGHT:
             return OP_TOP_LEFT;
             break;
+        case OP_LEFTEST_UP:
+            return OP_LEFTEST_DOWN;
+            break;
+        case OP_LEFTEST_DOWN:
+            return OP_LEFTEST_UP;
+            break;
+        case OP_BACKEST_CLOCKWISE:
+            return OP_BACKEST_COUNTER_CLOCKWISE;
+            break;
+        case OP_BACKEST_COUNTER_CLOCKWISE:
+            return OP_BACKEST_CLOCKWISE;
+            break;
         case OP_NOOP:
             return OP_NOOP;
         default:
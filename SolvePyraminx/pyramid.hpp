@@ -1,9 +1,12 @@
 
 #pragma once
 
+#include <array>
 #include <vector>
 #include <iostream>
 #include <list>
+#include <cstdint>
+#include <string_view>
 
 typedef unsigned int color;
 
@@ -16,9 +19,36 @@ extern const color YELLOW;
 enum Operation  { OP_NOOP
                 , OP_TURN_LEFT, OP_TURN_RIGHT, OP_RIGHT_CORNER_UP, OP_RIGHT_CORNER_DOWN, OP_LEFT_CORNER_UP, OP_LEFT_CORNER_DOWN
                 , OP_UPPER_RIGHT, OP_UPPER_LEFT, OP_RIGHT_UP, OP_RIGHT_DOWN, OP_LEFT_UP, OP_LEFT_DOWN, OP_BACK_CLOCKWISE, OP_BACK_COUNTER_CLOCKWISE
-                , OP_RIGHTEST_UP, OP_RIGHTEST_DOWN, OP_TOP_RIGHT, OP_TOP_LEFT};
+                , OP_RIGHTEST_UP, OP_RIGHTEST_DOWN, OP_TOP_RIGHT, OP_TOP_LEFT
+                , OP_LEFTEST_UP, OP_LEFTEST_DOWN, OP_BACKEST_CLOCKWISE, OP_BACKEST_COUNTER_CLOCKWISE};
 
-extern const std::list<Operation> allOperations;
+/// the number of operations, including OP_NOOP
+const int OPERATION_COUNT = OP_BACKEST_COUNTER_CLOCKWISE + 1;
+
+/// every operation, in the order of their values
+constexpr std::array<Operation, OPERATION_COUNT> allOperations =
+                { OP_NOOP
+                , OP_TURN_LEFT, OP_TURN_RIGHT, OP_RIGHT_CORNER_UP, OP_RIGHT_CORNER_DOWN, OP_LEFT_CORNER_UP, OP_LEFT_CORNER_DOWN
+                , OP_UPPER_RIGHT, OP_UPPER_LEFT, OP_RIGHT_UP, OP_RIGHT_DOWN, OP_LEFT_UP, OP_LEFT_DOWN, OP_BACK_CLOCKWISE, OP_BACK_COUNTER_CLOCKWISE
+                , OP_RIGHTEST_UP, OP_RIGHTEST_DOWN, OP_TOP_RIGHT, OP_TOP_LEFT
+                , OP_LEFTEST_UP, OP_LEFTEST_DOWN, OP_BACKEST_CLOCKWISE, OP_BACKEST_COUNTER_CLOCKWISE};
+
+/// the layer moves, which are the only moves needed to solve a pyramid apart from its tips. Searches unroll their loops over these (see forEachSolvingMove()).
+constexpr std::array<Operation, 8> solvingMoves = {
+    OP_UPPER_RIGHT, OP_UPPER_LEFT,
+    OP_RIGHT_UP, OP_RIGHT_DOWN,
+    OP_LEFT_UP, OP_LEFT_DOWN,
+    OP_BACK_CLOCKWISE, OP_BACK_COUNTER_CLOCKWISE
+};
+
+/// the operation that turns each tip by one step: the top, right, left and back tip, in the order of the digits of pyramid::tipTwists()
+extern const Operation tipMoves[4];
+
+/// the surfaces of a pyramid, in the order in which they appear in the string encoding
+enum Face { FACE_FRONT, FACE_RIGHT, FACE_LEFT, FACE_BOTTOM };
+
+/// the number of configurations that can be reached from a solved pyramid with layer moves (tips not counted)
+const size_t PYRAMID_STATES = 933120;
 
 /// print a color in just one letter
 void printColor(std::ostream &os, const color &c);
@@ -35,6 +65,8 @@ bool operator==(const surface &s1, const surface &s2);
 
 class surface   
 {
+    friend class pyramid;
+
     public:
 
     /// copy constructor that works by duplicating everything!
@@ -43,8 +75,8 @@ class surface
     /// initialize the surface with one color only, c.
     surface(color c);
 
-    /// initialize the surface from a string encoding described in the constructor pyramid(std::string).
-    surface(std::string &s);
+    /// initialize the surface from a string encoding described in the constructor pyramid(std::string_view).
+    explicit surface(std::string_view s);
 
     /// checks if all face colors are equal
     bool equal(const surface &s) const;
@@ -88,6 +120,12 @@ class surface
     /// returns a reference to the the colors bitfield
     unsigned int getColors() const;
 
+    /// returns the color of the tile at index i (0 <= i < 9, same order as in elements)
+    color getColor(int i) const;
+
+    /// sets the color of the tile at index i
+    void setColor(int i, color c);
+
     /// returns the color of the according edge
     color getTop() const;
     color getRightest() const;
@@ -126,12 +164,12 @@ class pyramid
 
     public:
 
-    /// this is for graph-algorithms that find it useful
-    mutable bool marked = false;
-
     /// explicit copy constructor, that duplicates all memory from pointers too
     pyramid(const pyramid &p);
 
+    /// the surfaces hold no pointers, so copying them member by member is enough
+    pyramid &operator=(const pyramid &p) = default;
+
     /// construct a pyramid with the following colors assigned to each surface
     pyramid(color front, color left, color right, color bott);
 
@@ -147,15 +185,24 @@ class pyramid
      *                         ggg      == "rg3y3rr"
      *                        yyyrr
      * An entire pyramid encoding: "g3brrb3,r6gyy,y4g5,brbby3bb"
+     * Throws a runtime_error if s is no such encoding. Use parsePyramid() to get an error code instead.
      */
-    pyramid(std::string s);
+    pyramid(std::string_view s);
 
     /// checkes whether p is exactly the same pyramid.
     bool equal(const pyramid &p) const;
 
-    /// checks whether p is the same pyramid up to whole rotations
+    /// checks whether p is the same pyramid up to whole rotations, by comparing the canonical forms
     bool equivalent(const pyramid &p) const;
 
+    /**
+     * Returns the unique representative of all whole rotations of this pyramid:
+     * the rotation where the surface that is red when solved is at the bottom, and the blue one is in the front.
+     * The solved colors are deduced from the axial centers, so this takes one rotation only.
+     * Pyramids whose centers do not show the colors in a valid way are represented by their smallest rotation instead.
+     */
+    pyramid canonical() const;
+
     /// equality by equivalence as defined above
     bool operator==(const pyramid&p) const;
 
@@ -250,6 +297,18 @@ class pyramid
     /// rotate the top tip of the pyramid towards the left
     void rotateTopLeft();
 
+    /// rotate the left tip of the pyramid upwards
+    void rotateLeftestUp();
+
+    /// rotate the left tip of the pyramid downwards
+    void rotateLeftestDown();
+
+    /// rotate the back tip of the pyramid clockwise from the front perspective
+    void rotateBackestClockwise();
+
+    /// rotate the back tip of the pyramid counter-clockwise from the front perspective
+    void rotateBackestCounterClockwise();
+
     surface getFront() const;
 
     surface getRight() const;
@@ -261,8 +320,57 @@ class pyramid
     /// saves this pyramid to a string that is of the format we read in the constructor from strings.
     std::string storageString() const;
 
+    /// copies the raw bitfields of the surfaces (see surface::elements) into bits, in the order of Face
+    void getBits(unsigned int bits[4]) const
+    {
+        bits[FACE_FRONT] = front.elements;
+        bits[FACE_RIGHT] = right.elements;
+        bits[FACE_LEFT] = left.elements;
+        bits[FACE_BOTTOM] = bottom.elements;
+    }
+
+    /// overwrites the raw bitfields of the surfaces, in the order of Face
+    void setBits(const unsigned int bits[4])
+    {
+        front.elements = bits[FACE_FRONT];
+        right.elements = bits[FACE_RIGHT];
+        left.elements = bits[FACE_LEFT];
+        bottom.elements = bits[FACE_BOTTOM];
+    }
+
+    /// returns the tile at the given index of the given surface
+    color getColor(Face f, int i) const;
+
+    /// sets the tile at the given index of the given surface
+    void setColor(Face f, int i, color c);
+
+    /**
+     * Computes a dense index in [0, PYRAMID_STATES) for this pyramid, based on the positions of the pieces only.
+     * The colors of the surfaces are deduced from the axial centers, so the index does not depend on the color scheme.
+     * The tips are ignored. The result is only meaningful for pyramids that can actually be reached by layer moves.
+     * The index is composed as follows: ((edgePermutation * 32) + edgeOrientation) * 81 + centerOrientation.
+     */
+    size_t rank() const;
+
+    /// packs all tiles apart from the tips into the lower 48 bits, so that two pyramids that only differ in their tips get the same key
+    uint64_t coreKey() const;
+
+    /// inverse of rank(): builds the pyramid with the given index, colored like "b9,g9,y9,r9", with tips aligned to their centers.
+    static pyramid unrank(size_t r);
+
+    /**
+     * The tip coordinate: how far each tip is twisted against its axial center, 3 values per tip, in 0..80.
+     * It is 0 if all tips are aligned. Layer moves turn a tip together with its center, so they never change it,
+     * and a pyramid is determined by its rank() and its tipTwists(), which together cover 933120 * 81 configurations.
+     */
+    int tipTwists() const;
+
     private:
 
+    /// returns the surface at the given position
+    surface &at(Face f);
+    const surface &at(Face f) const;
+
     surface front;
 
     surface left;
@@ -272,36 +380,123 @@ class pyramid
     surface bottom;
 };
 
-bool solve(pyramid &p, std::list<Operation> &moves);
+/**
+ * A pyramid in canonical orientation (see pyramid::canonical()), packed into two words,
+ * so that comparing two of them is a plain word compare. Use it as a key where pyramids are equal up to rotations.
+ */
+struct CanonicalPyramid
+{
+    /// the bitfields of the front, right and left surface, in 18 bits each
+    uint64_t sides;
+
+    /// the bitfield of the bottom surface
+    uint32_t bottom;
+
+    explicit CanonicalPyramid(const pyramid &p);
+
+    /// unpacks the canonical pyramid
+    pyramid toPyramid() const;
+
+    bool operator==(const CanonicalPyramid &c) const = default;
+};
+
+/// the finalizer of splitmix64: every input bit affects every output bit
+inline uint64_t mixHash(uint64_t x) noexcept
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+
+    return x;
+}
+
+/// hash a canonical pyramid into a set or map of a standard container
+struct hashCanonicalPyramid
+{
+    size_t operator()(const CanonicalPyramid &c) const noexcept
+    {
+        return mixHash(mixHash(c.sides) ^ c.bottom);
+    }
+};
+
+/// the search strategies of solve()
+enum SolveMode
+{
+    SOLVE_BFS,              // breadth-first search from p
+    SOLVE_BIDIRECTIONAL,    // breadth-first searches from p and from the solved pyramid, until they meet
+    SOLVE_IDA_STAR          // iterative deepening A* with pattern databases, see idastar.hpp
+};
+
+/**
+ * Finds a shortest sequence of layer moves that solves p apart from its tips, with the given search strategy,
+ * and appends it to moves followed by the tip moves (see solveTips()), so that the whole pyramid is solved.
+ * None of them needs precomputed tables, apart from the small pattern databases of SOLVE_IDA_STAR.
+ * Returns false if there is no solution, which means that p is no valid configuration.
+ */
+bool solve(pyramid &p, std::list<Operation> &moves, SolveMode mode = SOLVE_BFS);
+
+/// the reasons why the encoding of a pyramid cannot be parsed
+enum ParseError
+{
+    PARSE_OK,
+    PARSE_SURFACE_COUNT,        // not exactly 4 surfaces separated by commas
+    PARSE_LEADING_COUNT,        // a surface begins with a number
+    PARSE_TOO_MANY_TILES,
+    PARSE_TOO_FEW_TILES,
+    PARSE_ILLEGAL_CHARACTER     // neither a color letter nor a digit
+};
+
+/**
+ * Parses the encoding described at pyramid(std::string_view) into p, in a single pass, without allocating and without throwing.
+ * p is only changed if the result is PARSE_OK.
+ */
+ParseError parsePyramid(std::string_view s, pyramid &p);
+
+/**
+ * Parses every non-empty line of buffer, and appends the pyramid and the result of each line to ps and errors.
+ * Returns the number of lines that were parsed without error.
+ */
+size_t parsePyramids(std::string_view buffer, std::vector<pyramid> &ps, std::vector<ParseError> &errors);
+
+const char *parseErrorToString(ParseError e);
+
+/**
+ * Appends the tip moves that align the tips of p with their axial centers, at most one per tip.
+ * Since layer moves do not change how the tips are twisted, they can be appended to any solution of the rest, in constant time.
+ */
+void solveTips(const pyramid &p, std::list<Operation> &moves);
+
+/**
+ * checks that executing moves on p solves it, tips included. The searches only look at ranks or the tiles apart from the tips,
+ * and an invalid configuration (e.g. a single flipped edge) can share those with a solvable one, so every solution is checked with this.
+ */
+bool isSolution(const pyramid &p, const std::list<Operation> &moves);
 
 void executeOperation(pyramid &p, Operation op);
 
 std::string operationToString(const Operation &op);
 
-/// hash a pyramid into a set or map of a standard container:
+/// returns the operation that undoes op
+Operation reverseOp(const Operation &op);
+
+/// hash a pyramid into a set or map of a standard container. Equal up to whole rotations, like pyramid::operator==.
 struct hashPyramid
 {
     static size_t computeHash(const pyramid &p) noexcept
     {
-        /*
-        const unsigned int pf = p.front.getColors();
-        const unsigned int pr = p.right.getColors();
-        const unsigned int pl = p.left.getColors();
-        const unsigned int pb = p.bottom.getColors();
-
-        int p1 = std::popcount(pf);
-        int p2 = std::popcount(pr);
-        int p3 = std::popcount(pl);
-        int p4 = std::popcount(pb);
-
-        int x1 = p1*p2*p3*p4;
+        return hashCanonicalPyramid()(CanonicalPyramid(p));
+    }
 
-        return x1;//*/
+    /// the former hash: a product of small primes per surface. Kept to compare against, it collides a lot.
+    static size_t legacyHash(const pyramid &p) noexcept
+    {
         return p.front.computeHash() ^ p.right.computeHash() ^ p.left.computeHash() ^ p.bottom.computeHash();
     }
 
     size_t operator()(const pyramid& p) const noexcept
     {
-        return p.front.computeHash() ^ p.right.computeHash() ^ p.left.computeHash() ^ p.bottom.computeHash();
+        return computeHash(p);
     }
 };
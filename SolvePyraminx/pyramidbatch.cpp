@@ -0,0 +1,189 @@
+#include "pyramidbatch.hpp"
+#include "permutation.hpp"
+
+#include <array>
+#include <utility>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PYRAMID_BATCH_X86 1
+#endif
+
+/// how many pyramids the arrays are padded to
+static const size_t BATCH_PADDING = 8;
+
+PyramidBatch::PyramidBatch(size_t capacity) : count(0)
+{
+    reserve(capacity);
+}
+
+void PyramidBatch::reserve(size_t n)
+{
+    n = (n + BATCH_PADDING - 1) / BATCH_PADDING * BATCH_PADDING;
+
+    if(n > lanes[0].size())
+    {
+        for(std::vector<uint32_t> &lane: lanes)
+            lane.resize(std::max(n, 2 * lane.size()), 0);
+    }
+}
+
+void PyramidBatch::push_back(const pyramid &p)
+{
+    reserve(count + 1);
+
+    unsigned int bits[4];
+    p.getBits(bits);
+
+    for(int s=0; s<4; s++)
+        lanes[s][count] = bits[s];
+
+    count++;
+}
+
+pyramid PyramidBatch::at(size_t i) const
+{
+    if(i >= count)
+        throw std::out_of_range("PyramidBatch::at(): index out of range");
+
+    const unsigned int bits[4] = {lanes[0][i], lanes[1][i], lanes[2][i], lanes[3][i]};
+
+    pyramid p(RED, RED, RED, RED);
+    p.setBits(bits);
+
+    return p;
+}
+
+/// the kernel of K on n pyramids (a multiple of BATCH_PADDING), one after the other
+template<PermutationKernel K>
+static void applyScalar(uint32_t *lanes[4], size_t n)
+{
+    for(size_t i=0; i<n; i++)
+    {
+        unsigned int bits[4] = {lanes[0][i], lanes[1][i], lanes[2][i], lanes[3][i]};
+
+        applyKernel<K>(bits);
+
+        for(int s=0; s<4; s++)
+            lanes[s][i] = bits[s];
+    }
+}
+
+#ifdef PYRAMID_BATCH_X86
+
+template<PermutationKernel K, size_t... I>
+__attribute__((target("sse2"))) inline void applyTermsSSE2(const __m128i in[4], __m128i out[4], std::index_sequence<I...>)
+{
+    ((out[K.terms[I].to] = _mm_or_si128(out[K.terms[I].to], K.terms[I].shift >= 0
+        ? _mm_slli_epi32(_mm_and_si128(in[K.terms[I].from], _mm_set1_epi32(K.terms[I].mask)), K.terms[I].shift)
+        : _mm_srli_epi32(_mm_and_si128(in[K.terms[I].from], _mm_set1_epi32(K.terms[I].mask)), -K.terms[I].shift))), ...);
+}
+
+/// the kernel of K on 4 pyramids per step
+template<PermutationKernel K>
+__attribute__((target("sse2"))) static void applySSE2(uint32_t *lanes[4], size_t n)
+{
+    for(size_t i=0; i<n; i+=4)
+    {
+        __m128i in[4];
+        __m128i out[4];
+
+        for(int s=0; s<4; s++)
+        {
+            in[s] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes[s] + i));
+            out[s] = _mm_setzero_si128();
+        }
+
+        applyTermsSSE2<K>(in, out, std::make_index_sequence<K.size>());
+
+        for(int s=0; s<4; s++)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes[s] + i), out[s]);
+    }
+}
+
+template<PermutationKernel K, size_t... I>
+__attribute__((target("avx2"))) inline void applyTermsAVX2(const __m256i in[4], __m256i out[4], std::index_sequence<I...>)
+{
+    ((out[K.terms[I].to] = _mm256_or_si256(out[K.terms[I].to], K.terms[I].shift >= 0
+        ? _mm256_slli_epi32(_mm256_and_si256(in[K.terms[I].from], _mm256_set1_epi32(K.terms[I].mask)), K.terms[I].shift)
+        : _mm256_srli_epi32(_mm256_and_si256(in[K.terms[I].from], _mm256_set1_epi32(K.terms[I].mask)), -K.terms[I].shift))), ...);
+}
+
+/// the kernel of K on 8 pyramids per step
+template<PermutationKernel K>
+__attribute__((target("avx2"))) static void applyAVX2(uint32_t *lanes[4], size_t n)
+{
+    for(size_t i=0; i<n; i+=8)
+    {
+        __m256i in[4];
+        __m256i out[4];
+
+        for(int s=0; s<4; s++)
+        {
+            in[s] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes[s] + i));
+            out[s] = _mm256_setzero_si256();
+        }
+
+        applyTermsAVX2<K>(in, out, std::make_index_sequence<K.size>());
+
+        for(int s=0; s<4; s++)
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes[s] + i), out[s]);
+    }
+}
+
+#endif
+
+typedef void (*BatchKernel)(uint32_t *lanes[4], size_t n);
+
+/// the kernels of all operations for one instruction set, indexed by Operation
+template<size_t... I>
+static constexpr std::array<BatchKernel, OPERATION_COUNT> batchKernels(PyramidBatch::Kernel kernel, std::index_sequence<I...>)
+{
+    #ifdef PYRAMID_BATCH_X86
+    if(kernel == PyramidBatch::KERNEL_AVX2)
+        return {&applyAVX2<PermutationKernel(operationPermutations[I])>...};
+
+    if(kernel == PyramidBatch::KERNEL_SSE2)
+        return {&applySSE2<PermutationKernel(operationPermutations[I])>...};
+    #endif
+
+    return {&applyScalar<PermutationKernel(operationPermutations[I])>...};
+}
+
+static const std::array<BatchKernel, OPERATION_COUNT> kernels[3] = {
+    batchKernels(PyramidBatch::KERNEL_SCALAR, std::make_index_sequence<OPERATION_COUNT>()),
+    batchKernels(PyramidBatch::KERNEL_SSE2, std::make_index_sequence<OPERATION_COUNT>()),
+    batchKernels(PyramidBatch::KERNEL_AVX2, std::make_index_sequence<OPERATION_COUNT>())
+};
+
+PyramidBatch::Kernel PyramidBatch::bestKernel()
+{
+    #ifdef PYRAMID_BATCH_X86
+    if(__builtin_cpu_supports("avx2"))
+        return KERNEL_AVX2;
+
+    if(__builtin_cpu_supports("sse2"))
+        return KERNEL_SSE2;
+    #endif
+
+    return KERNEL_SCALAR;
+}
+
+void PyramidBatch::apply(Operation op)
+{
+    static const Kernel best = bestKernel();
+
+    apply(op, best);
+}
+
+void PyramidBatch::apply(Operation op, Kernel kernel)
+{
+    if(op < 0 || op >= OPERATION_COUNT)
+        throw std::runtime_error("PyramidBatch::apply(): unknown operation " + std::to_string(op));
+
+    uint32_t *l[4] = {lanes[0].data(), lanes[1].data(), lanes[2].data(), lanes[3].data()};
+
+    // the padding is processed too, which is harmless and saves a tail loop
+    kernels[kernel][op](l, (count + BATCH_PADDING - 1) / BATCH_PADDING * BATCH_PADDING);
+}
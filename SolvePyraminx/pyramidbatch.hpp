@@ -0,0 +1,54 @@
+#pragma once
+
+#include "pyramid.hpp"
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * Many pyramids stored as a structure of arrays: one array per surface, in the order of Face,
+ * holding the bitfields of that surface of all pyramids (see pyramid::getBits()).
+ * apply() executes an Operation on all of them at once, with the mask/shift steps of its PermutationKernel
+ * on 8 pyramids per instruction with AVX2, 4 with SSE2, or one after the other where neither is available.
+ */
+class PyramidBatch
+{
+    public:
+
+    /// the instruction sets that apply() can use
+    enum Kernel { KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2 };
+
+    explicit PyramidBatch(size_t capacity = 0);
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    void clear()
+    {
+        count = 0;
+    }
+
+    void push_back(const pyramid &p);
+
+    pyramid at(size_t i) const;
+
+    /// executes op on all pyramids, with the best kernel the processor supports
+    void apply(Operation op);
+
+    /// executes op on all pyramids with the given kernel, which the processor must support
+    void apply(Operation op, Kernel kernel);
+
+    /// the best kernel that this processor supports
+    static Kernel bestKernel();
+
+    private:
+
+    /// makes room for at least n pyramids. The arrays are padded to a multiple of 8 pyramids, so the kernels need no tail loop.
+    void reserve(size_t n);
+
+    std::vector<uint32_t> lanes[4];
+
+    size_t count;
+};
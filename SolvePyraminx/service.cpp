@@ -0,0 +1,416 @@
+#include "service.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/// the service stops reading requests of a connection while this many bytes of responses wait for the client to read them
+static const size_t MAX_PENDING_RESPONSES = 1 << 20;
+
+/// reads exactly size bytes, returns false at the end of the stream or on an error
+static bool readAll(int fd, void *data, size_t size)
+{
+    char *p = static_cast<char*>(data);
+
+    while(size > 0)
+    {
+        ssize_t n = ::read(fd, p, size);
+
+        if(n < 0 && errno == EINTR)
+            continue;
+
+        if(n <= 0)
+            return false;
+
+        p += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+static bool writeAll(int fd, const void *data, size_t size)
+{
+    const char *p = static_cast<const char*>(data);
+
+    while(size > 0)
+    {
+        ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+
+        if(n < 0 && errno == EINTR)
+            continue;
+
+        if(n <= 0)
+            return false;
+
+        p += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+/// appends payload to out, as a frame
+static void appendFrame(std::string &out, const std::string &payload)
+{
+    uint32_t size = payload.size();
+    const char length[4] = {char(size), char(size >> 8), char(size >> 16), char(size >> 24)};
+
+    out.append(length, 4);
+    out += payload;
+}
+
+static uint32_t frameLength(const char *p)
+{
+    return uint8_t(p[0]) | uint8_t(p[1]) << 8 | uint8_t(p[2]) << 16 | uint32_t(uint8_t(p[3])) << 24;
+}
+
+/// writes a frame with a single system call
+static bool writeFrame(int fd, const std::string &payload)
+{
+    std::string frame;
+    appendFrame(frame, payload);
+
+    return writeAll(fd, frame.data(), frame.size());
+}
+
+/// reads a frame into payload. Returns false at the end of the stream, or if the frame is longer than maxSize.
+static bool readFrame(int fd, std::string &payload, uint32_t maxSize)
+{
+    char length[4];
+
+    if(!readAll(fd, length, 4))
+        return false;
+
+    uint32_t size = frameLength(length);
+
+    if(size > maxSize)
+        return false;
+
+    payload.resize(size);
+
+    return readAll(fd, payload.data(), size);
+}
+
+/// removes the socket at path, but no other kind of file that a wrong path may point to
+static void removeSocket(const std::string &path)
+{
+    struct stat st;
+
+    if(::lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        ::unlink(path.c_str());
+}
+
+static sockaddr_un socketAddress(const std::string &path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+
+    if(path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("socket path too long: " + path);
+
+    std::strcpy(address.sun_path, path.c_str());
+
+    return address;
+}
+
+SolverService::SolverService(const std::string &path, const BatchSolver &solver) : path(path), solver(solver), stopped(false)
+{
+    const sockaddr_un address = socketAddress(path);
+
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if(listener < 0)
+        throw std::runtime_error("SolverService: could not create a socket: " + std::string(std::strerror(errno)));
+
+    // a regular file at path stays, and then bind() fails
+    removeSocket(path);
+
+    if(::pipe2(wakeup, O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        int error = errno;
+        ::close(listener);
+        throw std::runtime_error("SolverService: could not create a pipe: " + std::string(std::strerror(error)));
+    }
+
+    if(::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listener, 64) < 0)
+    {
+        int error = errno;
+        ::close(listener);
+        ::close(wakeup[0]);
+        ::close(wakeup[1]);
+        throw std::runtime_error("SolverService: could not listen on " + path + ": " + std::strerror(error));
+    }
+}
+
+SolverService::~SolverService()
+{
+    stop();
+
+    for(auto &[fd, thread]: connections)
+    {
+        thread.join();
+        ::close(fd);
+    }
+
+    ::close(listener);
+    ::close(wakeup[0]);
+    ::close(wakeup[1]);
+    removeSocket(path);
+}
+
+void SolverService::run()
+{
+    while(!stopped)
+    {
+        // wait for a new connection, or for one that has finished, so that idle servers do not keep the threads of closed ones
+        pollfd events[2] = {{listener, POLLIN, 0}, {wakeup[0], POLLIN, 0}};
+
+        if(::poll(events, 2, -1) < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        if(events[1].revents & POLLIN)
+        {
+            char drain[64];
+
+            while(::read(wakeup[0], drain, sizeof(drain)) > 0)
+                ;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            reap();
+        }
+
+        if(!(events[0].revents & (POLLIN | POLLERR | POLLHUP)))
+            continue;
+
+        int fd = ::accept(listener, nullptr, nullptr);
+
+        if(fd < 0)
+        {
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        reap();
+
+        if(stopped)
+        {
+            ::close(fd);
+            break;
+        }
+
+        connections.emplace(fd, std::thread(&SolverService::serve, this, fd));
+    }
+}
+
+void SolverService::reap()
+{
+    for(int fd: finished)
+    {
+        connections.at(fd).join();
+        connections.erase(fd);
+
+        // only now the number of the socket may be reused by accept()
+        ::close(fd);
+    }
+
+    finished.clear();
+}
+
+void SolverService::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    stopped = true;
+
+    // wakes up accept() and all reads, without closing the descriptors under the feet of the threads that use them
+    ::shutdown(listener, SHUT_RDWR);
+
+    for(auto &connection: connections)
+        ::shutdown(connection.first, SHUT_RDWR);
+
+    notify();
+}
+
+void SolverService::notify()
+{
+    // the pipe is non-blocking: if it is full, run() wakes up anyway
+    while(::write(wakeup[1], "", 1) < 0 && errno == EINTR)
+        ;
+}
+
+std::string SolverService::answer(std::string_view request) const
+{
+    std::string response;
+    pyramid p(RED, RED, RED, RED);
+    ParseError parsed = parsePyramid(request, p);
+
+    if(parsed != PARSE_OK)
+        return char(FRAME_ERROR) + std::string(parseErrorToString(parsed));
+
+    try
+    {
+        std::list<Operation> moves;
+
+        if(solver(p, moves))
+        {
+            response += char(FRAME_SOLVED);
+
+            for(Operation op: moves)
+                response += char(op);
+        }
+        else
+            response = char(FRAME_ERROR) + std::string("the pyramid cannot be solved");
+    }
+    catch(const std::exception &e)
+    {
+        response = char(FRAME_ERROR) + std::string(e.what());
+    }
+
+    return response;
+}
+
+void SolverService::serve(int fd)
+{
+    std::string in;
+    std::string out;
+    char chunk[65536];
+    bool reading = true;
+    bool broken = false;
+
+    // wait until the socket can be read or written, whichever comes first, so that the responses are sent while the client
+    // is still sending requests. Waiting for a write to finish before reading again deadlocks a client that pipelines requests,
+    // as soon as both socket buffers are full.
+    while(true)
+    {
+        // answer the complete requests that have arrived, as long as the responses that wait for the client stay bounded
+        size_t pos = 0;
+
+        while(!broken && out.size() < MAX_PENDING_RESPONSES && in.size() - pos >= 4)
+        {
+            uint32_t size = frameLength(in.data() + pos);
+
+            if(size > MAX_REQUEST_SIZE)
+            {
+                broken = true;
+                break;
+            }
+
+            if(in.size() - pos - 4 < size)
+                break;
+
+            appendFrame(out, answer(std::string_view(in).substr(pos + 4, size)));
+            pos += 4 + size;
+        }
+
+        in.erase(0, pos);
+
+        // stop reading while the client does not read its responses, and after a protocol error
+        const bool receiving = reading && !broken && out.size() < MAX_PENDING_RESPONSES;
+        const bool sending = !out.empty();
+
+        if(!receiving && !sending)
+            break;
+
+        pollfd events{fd, short((receiving ? POLLIN : 0) | (sending ? POLLOUT : 0)), 0};
+
+        if(::poll(&events, 1, -1) < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        if(sending && (events.revents & (POLLOUT | POLLERR | POLLHUP)))
+        {
+            ssize_t n = ::send(fd, out.data(), out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+
+            if(n < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+                break;
+
+            if(n > 0)
+                out.erase(0, n);
+        }
+
+        if(receiving && (events.revents & (POLLIN | POLLERR | POLLHUP)))
+        {
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+
+            // at the end of the stream, the requests that have arrived are still answered
+            if(n == 0)
+                reading = false;
+            else if(n > 0)
+                in.append(chunk, n);
+            else if(errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+                break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finished.push_back(fd);
+    notify();
+}
+
+SolverClient::SolverClient(const std::string &path)
+{
+    const sockaddr_un address = socketAddress(path);
+
+    fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if(fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        int error = errno;
+
+        if(fd >= 0)
+            ::close(fd);
+
+        throw std::runtime_error("SolverClient: could not connect to " + path + ": " + std::strerror(error));
+    }
+}
+
+SolverClient::~SolverClient()
+{
+    ::close(fd);
+}
+
+void SolverClient::send(const std::string &pyramid)
+{
+    if(!writeFrame(fd, pyramid))
+        throw std::runtime_error("SolverClient::send(): the connection was closed.");
+}
+
+bool SolverClient::receive(std::list<Operation> &moves, std::string &error)
+{
+    std::string response;
+
+    if(!readFrame(fd, response, UINT32_MAX) || response.empty())
+        throw std::runtime_error("SolverClient::receive(): the connection was closed.");
+
+    if(response[0] != char(FRAME_SOLVED))
+    {
+        error = response.substr(1);
+        return false;
+    }
+
+    for(size_t i=1; i<response.size(); i++)
+        moves.push_back(Operation(uint8_t(response[i])));
+
+    return true;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "batch.hpp"
+
+#include <string>
+#include <string_view>
+#include <list>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * The protocol of the SolverService. Every message is a frame: its length as a 32 bit little-endian number, then that many bytes.
+ * A request holds a pyramid in the format of pyramid::storageString(). The response starts with a status byte:
+ * FRAME_SOLVED is followed by the operations of the solution, one byte each, and FRAME_ERROR by a message text.
+ * Responses come in the order of the requests, so a client may send many requests before it reads the responses.
+ * The service keeps reading requests while it sends responses, but stops when about a megabyte of responses waits
+ * for the client, so a client that never reads will block at some point.
+ */
+const uint8_t FRAME_SOLVED = 0;
+const uint8_t FRAME_ERROR = 1;
+
+/// longer requests are protocol errors, and the connection is closed
+const uint32_t MAX_REQUEST_SIZE = 4096;
+
+/**
+ * Answers solve requests on a Unix domain socket, with a solver whose tables are built once and stay in memory.
+ * Every connection is served by its own thread, and all of them share the solver.
+ */
+class SolverService
+{
+    public:
+
+    /// listens on a socket at path, replacing a socket that is there. Throws a runtime_error if another kind of file is there.
+    SolverService(const std::string &path, const BatchSolver &solver);
+
+    /// stops the service, waits for the connections to close and removes the socket. run() must have returned.
+    ~SolverService();
+
+    SolverService(const SolverService&) = delete;
+    SolverService &operator=(const SolverService&) = delete;
+
+    /// accepts connections until stop() is called
+    void run();
+
+    /// makes run() return, and closes all connections. May be called from any thread.
+    void stop();
+
+    private:
+
+    void serve(int fd);
+
+    /// the payload of the response to a request
+    std::string answer(std::string_view request) const;
+
+    /// joins the threads of the connections that have finished, and closes their sockets
+    void reap();
+
+    /// wakes up run()
+    void notify();
+
+    std::string path;
+
+    BatchSolver solver;
+
+    int listener;
+
+    /// a pipe on which the threads of the connections wake up run() when they finish, and stop() when it is called
+    int wakeup[2];
+
+    std::atomic<bool> stopped;
+
+    std::mutex mutex;
+
+    /// the thread of every connection, by its socket
+    std::map<int, std::thread> connections;
+
+    /// the sockets of the connections whose threads have finished
+    std::vector<int> finished;
+};
+
+/// a connection to a SolverService
+class SolverClient
+{
+    public:
+
+    explicit SolverClient(const std::string &path);
+
+    ~SolverClient();
+
+    SolverClient(const SolverClient&) = delete;
+    SolverClient &operator=(const SolverClient&) = delete;
+
+    /// sends a request, without waiting for the response
+    void send(const std::string &pyramid);
+
+    /// reads the next response. Returns false if the pyramid could not be solved, and then error holds the reason.
+    bool receive(std::list<Operation> &moves, std::string &error);
+
+    private:
+
+    int fd;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * A hash map from state keys (such as pyramid::coreKey()) to 32 bit values, with open addressing and linear probing.
+ * Keys and values are stored in two flat arrays, so there is no allocation per element. It grows at half load.
+ */
+class StateMap
+{
+    public:
+
+    /// returned by find() for keys that are not in the map
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    explicit StateMap(size_t capacity = 1024) : keys(roundUp(capacity), EMPTY), values(keys.size()), count(0)
+    {
+
+    }
+
+    /// inserts key with value, and returns true, unless key is in the map already.
+    bool insert(uint64_t key, uint32_t value)
+    {
+        if(2 * (count + 1) > keys.size())
+            grow();
+
+        size_t i = slot(key);
+
+        if(keys[i] == key)
+            return false;
+
+        keys[i] = key;
+        values[i] = value;
+        count++;
+
+        return true;
+    }
+
+    /// returns the value of key, or NOT_FOUND
+    uint32_t find(uint64_t key) const
+    {
+        size_t i = slot(key);
+
+        return keys[i] == key ? values[i] : NOT_FOUND;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    private:
+
+    /// marks an empty slot. No state key uses all 64 bits.
+    static constexpr uint64_t EMPTY = UINT64_MAX;
+
+    static size_t roundUp(size_t n)
+    {
+        size_t c = 16;
+
+        while(c < n)
+            c *= 2;
+
+        return c;
+    }
+
+    /// the slot that holds key, or the empty slot where it would be inserted
+    size_t slot(uint64_t key) const
+    {
+        const size_t mask = keys.size() - 1;
+
+        // fibonacci hashing spreads the structured keys over the whole table
+        size_t i = (key * 0x9e3779b97f4a7c15ull) >> 20 & mask;
+
+        while(keys[i] != EMPTY && keys[i] != key)
+            i = (i + 1) & mask;
+
+        return i;
+    }
+
+    void grow()
+    {
+        std::vector<uint64_t> oldKeys(2 * keys.size(), EMPTY);
+        std::vector<uint32_t> oldValues(oldKeys.size());
+
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+
+        for(size_t j=0; j<oldKeys.size(); j++)
+        {
+            if(oldKeys[j] != EMPTY)
+            {
+                size_t i = slot(oldKeys[j]);
+                keys[i] = oldKeys[j];
+                values[i] = oldValues[j];
+            }
+        }
+    }
+
+    std::vector<uint64_t> keys;
+
+    std::vector<uint32_t> values;
+
+    size_t count;
+};
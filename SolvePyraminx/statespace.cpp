@@ -0,0 +1,78 @@
+#include "statespace.hpp"
+#include "graph.hpp"
+
+#include <atomic>
+
+StateSpace::StateSpace(unsigned int threads, const LayerCallback &onLayer) : visited((PYRAMID_STATES + 63) / 64, 0), count(1), depth(0)
+{
+    threads = std::max(threads, 1u);
+
+    // the rank range only bounds the bitset. How many ranks are actually reached is found out by the search.
+    const ImplicitGraph graph;
+    std::vector<uint32_t> layer = {0};      // rank 0 is the solved pyramid
+    visited[0] = 1;
+
+    if(onLayer)
+        onLayer(0, 1);
+
+    std::vector<std::vector<uint32_t>> next(threads);
+
+    while(true)
+    {
+        // thread t expands the t-th contiguous slice of the layer into its own part of the next layer
+        auto expand = [&](unsigned int t)
+        {
+            const size_t begin = layer.size() * t / threads;
+            const size_t end = layer.size() * (t + 1) / threads;
+
+            next[t].clear();
+
+            for(size_t i=begin; i<end; i++)
+            {
+                for(Edge e: graph.neighbors(layer[i]))
+                {
+                    const size_t r = edgeTarget(e);
+                    const uint64_t bit = uint64_t(1) << (r % 64);
+
+                    // only the thread that sets the bit adds the configuration to the next layer
+                    if(!(std::atomic_ref<uint64_t>(visited[r / 64]).fetch_or(bit, std::memory_order_relaxed) & bit))
+                        next[t].push_back(r);
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+
+        for(unsigned int t=1; t<threads; t++)
+            workers.emplace_back(expand, t);
+
+        expand(0);
+
+        for(std::thread &w: workers)
+            w.join();
+
+        layer.clear();
+
+        for(const std::vector<uint32_t> &part: next)
+            layer.insert(layer.end(), part.begin(), part.end());
+
+        if(layer.empty())
+            break;
+
+        depth++;
+        count += layer.size();
+
+        if(onLayer)
+            onLayer(depth, layer.size());
+    }
+}
+
+size_t StateSpace::size() const
+{
+    return count;
+}
+
+int StateSpace::maxDepth() const
+{
+    return depth;
+}
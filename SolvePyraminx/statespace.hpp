@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pyramid.hpp"
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <thread>
+
+/**
+ * The set of all configurations that can be reached from the solved pyramid, found by a breadth-first search
+ * that processes one layer of equal distance after the other. Each layer is split across several threads,
+ * which deduplicate through a shared bitset indexed by rank, set with atomic operations and without locks.
+ * The search ends when a layer is empty, so the number of reachable configurations needs not be known in advance.
+ */
+class StateSpace
+{
+    public:
+
+    /// called after each layer with its depth and its number of configurations
+    typedef std::function<void(int depth, size_t count)> LayerCallback;
+
+    /// generates the state space with the given number of threads
+    explicit StateSpace(unsigned int threads = std::thread::hardware_concurrency(), const LayerCallback &onLayer = {});
+
+    /// whether the configuration with rank r is reachable
+    bool contains(size_t r) const
+    {
+        return (visited[r / 64] >> (r % 64)) & 1;
+    }
+
+    /// the number of reachable configurations
+    size_t size() const;
+
+    /// the largest distance from the solved pyramid
+    int maxDepth() const;
+
+    private:
+
+    /// one bit per rank
+    std::vector<uint64_t> visited;
+
+    size_t count;
+
+    int depth;
+};
@@ -0,0 +1,364 @@
+#include "surfacekernels.hpp"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SURFACE_KERNELS_X86 1
+#endif
+
+/// the tile that each tile of a surface moves to, see surface::elements for the indices
+typedef std::array<uint8_t, 9> TileTargets;
+
+static constexpr TileTargets inverse(const TileTargets &targets)
+{
+    TileTargets inv{};
+
+    for(int t=0; t<9; t++)
+        inv[targets[t]] = t;
+
+    return inv;
+}
+
+static constexpr TileTargets clockwiseTargets = {8, 3, 7, 6, 0, 2, 1, 5, 4};
+static constexpr TileTargets upperTargets = {3, 0, 2, 1, 4, 5, 6, 7, 8};
+static constexpr TileTargets leftTargets = {0, 6, 2, 3, 1, 5, 4, 7, 8};
+static constexpr TileTargets rightTargets = {0, 1, 2, 8, 4, 5, 3, 7, 6};
+
+/// indexed by SurfacePermutation
+static constexpr std::array<TileTargets, SURFACE_PERMUTATION_COUNT> tileTargets = {
+    clockwiseTargets, inverse(clockwiseTargets),
+    upperTargets, inverse(upperTargets),
+    leftTargets, inverse(leftTargets),
+    rightTargets, inverse(rightTargets)
+};
+
+static constexpr uint32_t tileMask(int t)
+{
+    return 0b11u << 2*(8-t);
+}
+
+// the portable kernels. Code generated here for bit permutations: https://programming.sirrida.de/calcperm.php
+
+static unsigned int clockwisePortable(unsigned int x)
+{
+    // MSB first, target bits: 1 0 11 10 3 2 5 4 17 16 13 12 15 14 7 6 9 8
+    return ((x & 0x0000000c) << 4)
+    | ((x & 0x000000c0) << 6)
+    | ((x & 0x00000303) << 8)
+    | ((x & 0x00000030) << 10)
+    | ((x & 0x00030000) >> 16)
+    | ((x & 0x00003000) >> 10)
+    | ((x & 0x00000c00) >> 6)
+    | ((x & 0x0000c000) >> 4);
+}
+
+static unsigned int counterClockwisePortable(unsigned int x)
+{
+    // MSB first, source bits: 1 0 11 10 3 2 5 4 17 16 13 12 15 14 7 6 9 8
+    // (this is the same mapping as for clockwise, but with source instead of target bits!)
+    return ((x & 0x00000c00) << 4)
+    | ((x & 0x00000030) << 6)
+    | ((x & 0x0000000c) << 10)
+    | ((x & 0x00000003) << 16)
+    | ((x & 0x0000c000) >> 10)
+    | ((x & 0x00030300) >> 8)
+    | ((x & 0x00003000) >> 6)
+    | ((x & 0x000000c0) >> 4);
+}
+
+static unsigned int upperClockwisePortable(unsigned int x)
+{
+    // MSB first, target bits: 11 10 17 16 13 12 15 14 9 8 7 6 5 4 3 2 1 0
+    return (x & 0x000033ff)
+    | ((x & 0x0000c000) << 2)
+    | ((x & 0x00000c00) << 4)
+    | ((x & 0x00030000) >> 6);
+}
+
+static unsigned int upperCounterClockwisePortable(unsigned int x)
+{
+    // MSB first, source bits: 11 10 17 16 13 12 15 14 9 8 7 6 5 4 3 2 1 0
+    return (x & 0x000033ff)
+    | ((x & 0x00000c00) << 6)
+    | ((x & 0x0000c000) >> 4)
+    | ((x & 0x00030000) >> 2);
+}
+
+static unsigned int leftClockwisePortable(unsigned int x)
+{
+    // MSB first, target bits: 17 16 5 4 13 12 11 10 15 14 7 6 9 8 3 2 1 0
+    return (x & 0x00033ccf)
+    | ((x & 0x00000030) << 4)
+    | ((x & 0x00000300) << 6)
+    | ((x & 0x0000c000) >> 10);
+}
+
+static unsigned int leftCounterClockwisePortable(unsigned int x)
+{
+    // MSB first, source bits: 17 16 5 4 13 12 11 10 15 14 7 6 9 8 3 2 1 0
+    return (x & 0x00033ccf)
+    | ((x & 0x00000030) << 10)
+    | ((x & 0x0000c000) >> 6)
+    | ((x & 0x00000300) >> 4);
+}
+
+static unsigned int rightClockwisePortable(unsigned int x)
+{
+    // MSB first, target bits: 17 16 15 14 13 12 1 0 9 8 7 6 11 10 3 2 5 4
+    return (x & 0x0003f3cc)
+    | ((x & 0x00000003) << 4)
+    | ((x & 0x00000030) << 6)
+    | ((x & 0x00000c00) >> 10);
+}
+
+static unsigned int rightCounterClockwisePortable(unsigned int x)
+{
+    // MSB first, source bits: 17 16 15 14 13 12 1 0 9 8 7 6 11 10 3 2 5 4
+    return (x & 0x0003f3cc)
+    | ((x & 0x00000003) << 10)
+    | ((x & 0x00000c00) >> 6)
+    | ((x & 0x00000030) >> 4);
+}
+
+static constexpr SurfaceFunction portableFunctions[SURFACE_PERMUTATION_COUNT] = {
+    clockwisePortable, counterClockwisePortable,
+    upperClockwisePortable, upperCounterClockwisePortable,
+    leftClockwisePortable, leftCounterClockwisePortable,
+    rightClockwisePortable, rightCounterClockwisePortable
+};
+
+/**
+ * A tile permutation as groups of tiles whose order does not change, so that each group moves with one pext and one pdep.
+ * Tiles that stay in place are only masked.
+ */
+struct GatherPlan
+{
+    uint32_t keep;
+
+    int size;
+
+    uint32_t from[9];
+
+    uint32_t to[9];
+};
+
+static constexpr GatherPlan gatherPlan(const TileTargets &targets)
+{
+    GatherPlan plan{};
+    uint8_t last[9]{};
+
+    // first fit: a tile joins the first group whose last tile moves to a smaller index
+    for(int t=0; t<9; t++)
+    {
+        if(targets[t] == t)
+        {
+            plan.keep |= tileMask(t);
+            continue;
+        }
+
+        int g = 0;
+
+        while(g < plan.size && last[g] > targets[t])
+            g++;
+
+        if(g == plan.size)
+            plan.size++;
+
+        last[g] = targets[t];
+        plan.from[g] |= tileMask(t);
+        plan.to[g] |= tileMask(targets[t]);
+    }
+
+    return plan;
+}
+
+/**
+ * A tile permutation as byte shuffle: lane t of the shuffle control selects the byte of the bitfield that holds the tile
+ * moving to tile t, and the mask of lane t selects that tile within the byte. Lanes 9 to 15 are cleared.
+ */
+struct ShufflePlan
+{
+    uint8_t control[16];
+
+    uint8_t mask[16];
+};
+
+static constexpr ShufflePlan shufflePlan(const TileTargets &targets)
+{
+    const TileTargets sources = inverse(targets);
+    ShufflePlan plan{};
+
+    for(int t=0; t<16; t++)
+    {
+        if(t < 9)
+        {
+            const int bit = 2*(8 - sources[t]);
+
+            plan.control[t] = bit / 8;
+            plan.mask[t] = 0b11 << bit % 8;
+        }
+        else
+        {
+            plan.control[t] = 0x80;
+            plan.mask[t] = 0;
+        }
+    }
+
+    return plan;
+}
+
+#ifdef SURFACE_KERNELS_X86
+
+template<SurfacePermutation P>
+__attribute__((target("bmi2"))) static unsigned int permuteBMI2(unsigned int x)
+{
+    static constexpr GatherPlan plan = gatherPlan(tileTargets[P]);
+
+    unsigned int y = x & plan.keep;
+
+    for(int g=0; g<plan.size; g++)
+        y |= _pdep_u32(_pext_u32(x, plan.from[g]), plan.to[g]);
+
+    return y;
+}
+
+template<SurfacePermutation P>
+__attribute__((target("ssse3"))) static unsigned int permuteShuffle(unsigned int x)
+{
+    static constexpr ShufflePlan plan = shufflePlan(tileTargets[P]);
+
+    // maps a nibble that holds one tile at bit 0 or 2 to the color of that tile
+    const __m128i nibbleColors = _mm_setr_epi8(0, 1, 2, 3, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+    const __m128i lowNibbles = _mm_set1_epi8(0x0f);
+
+    const __m128i control = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plan.control));
+    const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plan.mask));
+
+    // lane t: the byte with the tile that moves to t, cut down to that tile, then shifted to bit 0
+    const __m128i tiles = _mm_and_si128(_mm_shuffle_epi8(_mm_cvtsi32_si128(x), control), mask);
+    const __m128i colors = _mm_or_si128(_mm_shuffle_epi8(nibbleColors, _mm_and_si128(tiles, lowNibbles)),
+                                        _mm_shuffle_epi8(nibbleColors, _mm_and_si128(_mm_srli_epi16(tiles, 4), lowNibbles)));
+
+    // pack tiles 0-3, 4-7 and 8 into one byte each, the smaller index at the higher bits
+    const __m128i pairs = _mm_maddubs_epi16(colors, _mm_set1_epi16(0x0104));
+    const __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00010010));
+
+    const unsigned int upper = _mm_cvtsi128_si32(quads);
+    const unsigned int middle = _mm_cvtsi128_si32(_mm_srli_si128(quads, 4));
+    const unsigned int last = _mm_cvtsi128_si32(_mm_srli_si128(quads, 8));
+
+    return (upper << 10) | (middle << 2) | (last >> 6);
+}
+
+template<size_t... P>
+static constexpr std::array<SurfaceFunction, SURFACE_PERMUTATION_COUNT> bmi2Functions(std::index_sequence<P...>)
+{
+    return {&permuteBMI2<SurfacePermutation(P)>...};
+}
+
+template<size_t... P>
+static constexpr std::array<SurfaceFunction, SURFACE_PERMUTATION_COUNT> shuffleFunctions(std::index_sequence<P...>)
+{
+    return {&permuteShuffle<SurfacePermutation(P)>...};
+}
+
+static constexpr std::array<SurfaceFunction, SURFACE_PERMUTATION_COUNT> kernelFunctions[SURFACE_KERNEL_COUNT] = {
+    {portableFunctions[0], portableFunctions[1], portableFunctions[2], portableFunctions[3],
+     portableFunctions[4], portableFunctions[5], portableFunctions[6], portableFunctions[7]},
+    bmi2Functions(std::make_index_sequence<SURFACE_PERMUTATION_COUNT>()),
+    shuffleFunctions(std::make_index_sequence<SURFACE_PERMUTATION_COUNT>())
+};
+
+#endif
+
+bool surfaceKernelSupported(SurfaceKernel kernel)
+{
+    switch(kernel)
+    {
+        case SURFACE_KERNEL_PORTABLE:
+            return true;
+
+        #ifdef SURFACE_KERNELS_X86
+        case SURFACE_KERNEL_BMI2:
+            // the cpu model may not be initialized yet if this runs in a static initializer
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("bmi2");
+
+        case SURFACE_KERNEL_SHUFFLE:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("ssse3");
+        #endif
+
+        default:
+            return false;
+    }
+}
+
+/// the functions of kernel, indexed by SurfacePermutation
+static const SurfaceFunction *functionsOf(SurfaceKernel kernel)
+{
+    #ifdef SURFACE_KERNELS_X86
+    return kernelFunctions[kernel].data();
+    #else
+    (void)kernel;
+    return portableFunctions;
+    #endif
+}
+
+unsigned int permuteSurface(unsigned int elements, SurfacePermutation p, SurfaceKernel kernel)
+{
+    return functionsOf(kernel)[p](elements);
+}
+
+bool checkSurfaceKernel(SurfaceKernel kernel, bool exhaustive)
+{
+    if(!surfaceKernelSupported(kernel))
+        return false;
+
+    const SurfaceFunction *functions = functionsOf(kernel);
+    uint32_t x = 0x2545f;
+
+    for(uint32_t i=0; i < (exhaustive ? 1u << 18 : 512u); i++)
+    {
+        // a few hundred pseudo-random bitfields are enough to catch a wrong mask or shift
+        if(!exhaustive)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+        }
+
+        const unsigned int elements = exhaustive ? i : x & 0x3ffff;
+
+        for(int p=0; p<SURFACE_PERMUTATION_COUNT; p++)
+        {
+            if(functions[p](elements) != portableFunctions[p](elements))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static std::atomic<SurfaceKernel> activeKernel(SURFACE_KERNEL_PORTABLE);
+
+std::atomic<const SurfaceFunction*> surfaceFunctions(portableFunctions);
+
+bool selectSurfaceKernel(SurfaceKernel kernel)
+{
+    if(kernel != SURFACE_KERNEL_PORTABLE && !checkSurfaceKernel(kernel))
+        return false;
+
+    activeKernel.store(kernel, std::memory_order_relaxed);
+    surfaceFunctions.store(functionsOf(kernel), std::memory_order_relaxed);
+
+    return true;
+}
+
+SurfaceKernel activeSurfaceKernel()
+{
+    return activeKernel.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+
+/// the permutations of the tiles of one surface, that the rotations of the surface class do
+enum SurfacePermutation
+{
+    SURFACE_CLOCKWISE, SURFACE_COUNTER_CLOCKWISE,
+    SURFACE_UPPER_CLOCKWISE, SURFACE_UPPER_COUNTER_CLOCKWISE,
+    SURFACE_LEFT_CLOCKWISE, SURFACE_LEFT_COUNTER_CLOCKWISE,
+    SURFACE_RIGHT_CLOCKWISE, SURFACE_RIGHT_COUNTER_CLOCKWISE,
+    SURFACE_PERMUTATION_COUNT
+};
+
+/**
+ * The implementations of the surface permutations:
+ *  portable: the mask/shift cascades, one term per distance that tiles move
+ *  BMI2:     one pext/pdep pair per group of tiles that keep their order, and a mask for the tiles that stay in place
+ *  shuffle:  one pshufb moves the tile that ends up at each index into a byte of its own, pmaddubsw/pmaddwd pack them again
+ */
+enum SurfaceKernel { SURFACE_KERNEL_PORTABLE, SURFACE_KERNEL_BMI2, SURFACE_KERNEL_SHUFFLE, SURFACE_KERNEL_COUNT };
+
+typedef unsigned int (*SurfaceFunction)(unsigned int elements);
+
+/// the functions of the active kernel (see activeSurfaceKernel()), indexed by SurfacePermutation
+extern std::atomic<const SurfaceFunction*> surfaceFunctions;
+
+/// permutes the tiles of a surface bitfield (see surface::getColors()) with the active kernel
+inline unsigned int permuteSurface(unsigned int elements, SurfacePermutation p)
+{
+    return surfaceFunctions.load(std::memory_order_relaxed)[p](elements);
+}
+
+/// permutes the tiles of a surface bitfield with the given kernel, which the processor must support
+unsigned int permuteSurface(unsigned int elements, SurfacePermutation p, SurfaceKernel kernel);
+
+/// checks if the processor can run the kernel
+bool surfaceKernelSupported(SurfaceKernel kernel);
+
+/**
+ * Compares the results of kernel to those of the portable kernel, for all permutations.
+ * Checks all 2^18 bitfields if exhaustive is set, else only a few hundred. Returns false if the processor does not support kernel.
+ */
+bool checkSurfaceKernel(SurfaceKernel kernel, bool exhaustive = false);
+
+/**
+ * Makes kernel the one that permuteSurface() and the surface rotations use, if the processor supports it and it passes
+ * the self-check (see checkSurfaceKernel()). Returns false, and keeps the active kernel, otherwise.
+ * The portable kernel is active until this is called: the others were not faster in our measurements, and the pyramid moves
+ * do not rotate single surfaces anyway (see applyOperation()), so no process should pay for a check at startup.
+ */
+bool selectSurfaceKernel(SurfaceKernel kernel);
+
+/// the kernel that permuteSurface() uses
+SurfaceKernel activeSurfaceKernel();
@@ -0,0 +1,118 @@
+#include "tablefile.hpp"
+#include "pyramid.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char tableMagic[4] = {'P', 'Y', 'R', 'T'};
+
+uint64_t tableChecksum(const void *data, size_t length)
+{
+    const uint64_t prime = 0x100000001b3ull;
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    size_t i = 0;
+
+    for(; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+
+        // the multiplication only carries a flipped bit upwards, so without mixing the word first,
+        // flips of the top bit in any two words would cancel out
+        hash = (hash ^ mixHash(word)) * prime;
+    }
+
+    for(; i < length; i++)
+        hash = (hash ^ bytes[i]) * prime;
+
+    return hash;
+}
+
+void writeTable(const std::string &filename, TableKind kind, const void *records, uint32_t recordSize, uint64_t count)
+{
+    TableHeader header;
+    std::memcpy(header.magic, tableMagic, 4);
+    header.version = TABLE_FORMAT_VERSION;
+    header.kind = kind;
+    header.recordSize = recordSize;
+    header.records = count;
+    header.checksum = tableChecksum(records, recordSize * count);
+
+    std::ofstream ofs(filename, std::ios::binary);
+
+    if(!ofs.good())
+        throw std::runtime_error("writeTable(): could not open " + filename);
+
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.write(static_cast<const char*>(records), recordSize * count);
+
+    if(!ofs.good())
+        throw std::runtime_error("writeTable(): could not write " + filename);
+}
+
+MappedTable::MappedTable(const std::string &filename, TableKind kind, uint32_t recordSize, bool verify) : mapping(nullptr), length(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+
+    if(fd < 0)
+        throw std::runtime_error("MappedTable: could not open " + filename);
+
+    struct stat st;
+
+    if(fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(TableHeader))
+    {
+        close(fd);
+        throw std::runtime_error("MappedTable: " + filename + " is too short for a table file");
+    }
+
+    length = st.st_size;
+    void *m = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);                                  // the mapping stays valid without the descriptor
+
+    if(m == MAP_FAILED)
+        throw std::runtime_error("MappedTable: could not map " + filename);
+
+    mapping = static_cast<const unsigned char*>(m);
+
+    const TableHeader *header = reinterpret_cast<const TableHeader*>(mapping);
+    const size_t payload = length - sizeof(TableHeader);
+    std::string error;
+
+    if(std::memcmp(header->magic, tableMagic, 4) != 0)
+        error = "is no table file";
+    else if(header->version != TABLE_FORMAT_VERSION)
+        error = "has format version " + std::to_string(header->version) + ", expected " + std::to_string(TABLE_FORMAT_VERSION);
+    else if(header->kind != kind)
+        error = "holds the wrong kind of table";
+    else if(header->recordSize != recordSize)
+        error = "has records of " + std::to_string(header->recordSize) + " bytes, expected " + std::to_string(recordSize);
+    // the payload is divided by the record size, since records * recordSize can overflow for a broken header
+    else if(recordSize == 0 || payload % recordSize != 0 || payload / recordSize != header->records)
+        error = "has the wrong length for its number of records";
+    else if(verify && tableChecksum(mapping + sizeof(TableHeader), payload) != header->checksum)
+        error = "is corrupt (checksum mismatch)";
+
+    if(!error.empty())
+    {
+        munmap(const_cast<unsigned char*>(mapping), length);
+        throw std::runtime_error("MappedTable: " + filename + " " + error);
+    }
+}
+
+MappedTable::~MappedTable()
+{
+    munmap(const_cast<unsigned char*>(mapping), length);
+}
+
+uint64_t MappedTable::size() const
+{
+    return reinterpret_cast<const TableHeader*>(mapping)->records;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/// the version of the binary table format, stored in every header. Files of another version are rejected.
+const uint32_t TABLE_FORMAT_VERSION = 3;
+
+/// what the records of a table file are
+enum TableKind : uint32_t { TABLE_NODES = 1, TABLE_EDGES = 2, TABLE_DISTANCES = 3 };
+
+/**
+ * The header at the beginning of every binary table file. It is followed by the records, recordSize bytes each.
+ * All numbers are stored in the byte order of the machine that wrote the file; a file from a machine
+ * with another byte order is rejected because its version does not match.
+ */
+struct TableHeader
+{
+    char magic[4];          // "PYRT"
+    uint32_t version;       // TABLE_FORMAT_VERSION
+    uint32_t kind;          // a TableKind
+    uint32_t recordSize;    // in bytes
+    uint64_t records;       // the number of records
+    uint64_t checksum;      // tableChecksum() of all records
+};
+
+/// record of a node table: the bitfields of the surfaces (see surface::elements) of one pyramid, in the order of Face
+struct NodeRecord
+{
+    uint32_t surfaces[4];
+};
+
+/// record of an edge table: the edges that leave one node, one for each of the solvingMoves in their order.
+/// Each edge holds the id of its target in the lower 24 bits and the Operation in the upper 8 bits (see PyramidGraph).
+struct EdgeRecord
+{
+    uint32_t edges[8];
+};
+
+/// a checksum over whole 64 bit words, each mixed with mixHash() and then combined FNV-1a style, with the remaining bytes added one by one
+uint64_t tableChecksum(const void *data, size_t length);
+
+/// writes count records of recordSize bytes each to a new table file. Throws a runtime_error on failure.
+void writeTable(const std::string &filename, TableKind kind, const void *records, uint32_t recordSize, uint64_t count);
+
+/**
+ * A table file that is mapped read-only into memory, so loading it costs no parsing and no copying,
+ * and all processes on a host that map the same file share its pages.
+ * The header and the length are checked on construction. The checksum is checked only if verify is set:
+ * that reads the whole file, which would cost every process that maps the table the time that mapping saves.
+ */
+class MappedTable
+{
+    public:
+
+    MappedTable(const std::string &filename, TableKind kind, uint32_t recordSize, bool verify = false);
+
+    MappedTable(const MappedTable &t) = delete;
+
+    MappedTable &operator=(const MappedTable &t) = delete;
+
+    ~MappedTable();
+
+    /// the number of records
+    uint64_t size() const;
+
+    /// the records, interpreted as T (which must have the record size)
+    template<class T>
+    const T *records() const
+    {
+        return reinterpret_cast<const T*>(mapping + sizeof(TableHeader));
+    }
+
+    private:
+
+    const unsigned char *mapping;
+
+    size_t length;
+};
@@ -1,7 +1,26 @@
 
 #include "basic.hpp"
 #include "testpyramid.hpp"
+#include "distancetable.hpp"
+#include "statespace.hpp"
+#include "graph.hpp"
+#include "coordinates.hpp"
+#include "permutation.hpp"
+#include "pyramidbatch.hpp"
+#include "surfacekernels.hpp"
+#include "batch.hpp"
+#include "service.hpp"
 
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <thread>
+
+#include <unistd.h>
+
+
+/// pyramids that cannot be solved: an odd permutation of the edges, and a single flipped edge
+static const std::list<std::string> invalidPyramids = {"b9,g6yg2,y6gy2,r9", "byb7,g9,y3by5,r9"};
 
 static const std::list<std::pair<std::list<std::string>,std::list<Operation>>> testCases = {
     {
@@ -73,6 +92,41 @@ void runAllTests()
         t++;
     }
 
+    const std::list<std::pair<std::string, int(*)()>> namedTests = {
+        {"Ranking", runRankingTest},
+        {"Parser", runParserTest},
+        {"Coordinates", runCoordinateTest},
+        {"Pyramid batch", runPyramidBatchTest},
+        {"Surface kernels", runSurfaceKernelTest},
+        {"Operation identity", runOperationIdentityTest},
+        {"Macro operations", runMacroOperationTest},
+        {"Canonical form", runCanonicalTest},
+        {"Distance table", runDistanceTableTest},
+        {"State space", runStateSpaceTest},
+        {"Implicit graph", runImplicitGraphTest},
+        {"Pyramid graph", runPyramidGraphTest},
+        {"Breadth-first solver", runSolveTest},
+        {"Batch", runBatchTest},
+        {"Solver service", runServiceTest}
+    };
+
+    for(auto &[name, test]: namedTests)
+    {
+        int status = test();
+
+        if(status > 0)
+            success++;
+        else if(status == 0)
+            skipped++;
+        else
+        {
+            failed++;
+            std::cout << name << " test failed." << std::endl;
+        }
+
+        t++;
+    }
+
     std::cout << std::endl << std::endl << "    TEST STATUS" << std::endl;
     std::cout << "Total test: " << t << ". Successful tests: " << success << ". Failures: " << failed << ". Skipped: " << skipped << "." << std::endl;
 }
@@ -105,3 +159,841 @@ int runTestCase(const std::list<pyramid> &configs, const std::list<Operation> &o
 
     return 1;
 }
+
+int runRankingTest()
+{
+    if(pyramid("b9,g9,y9,r9").rank() != 0 || pyramid("y9,r9,b9,g9").rank() != 0)
+    {
+        std::cout << "A solved pyramid does not have rank 0." << std::endl;
+        return -1;
+    }
+
+    for(size_t r=0; r<PYRAMID_STATES; r++)
+    {
+        pyramid p = pyramid::unrank(r);
+
+        if(p.rank() != r)
+        {
+            std::cout << "Ranking failure: unrank(" << r << ") has rank " << p.rank() << ":" << std::endl << p << std::endl;
+            return -1;
+        }
+
+        executeOperation(p, OP_BACK_CLOCKWISE);
+
+        if(p.rank() >= PYRAMID_STATES || !pyramid::unrank(p.rank()).equal(p))
+        {
+            std::cout << "Ranking failure: a neighbor of " << r << " is not ranked properly:" << std::endl << p << std::endl;
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+/// the distance table is expensive to build, so all tests share one
+static const DistanceTable &sharedDistanceTable()
+{
+    static const DistanceTable table;
+    return table;
+}
+
+int runDistanceTableTest()
+{
+    const DistanceTable &table = sharedDistanceTable();
+
+    for(auto &testpair: testCases)
+    {
+        for(auto &s: testpair.first)
+        {
+            pyramid p(s);
+            std::list<Operation> moves;
+
+            // at most one move per tip after the layer moves
+            if(!table.solve(p, moves) || moves.size() > size_t(table.maxDistance()) + 4)
+            {
+                std::cout << "The distance table did not solve " << s << " properly." << std::endl;
+                return -1;
+            }
+
+            for(Operation op: moves)
+                executeOperation(p, op);
+
+            if(!p.isSolved())
+            {
+                std::cout << "The distance table solution for " << s << " does not solve it:" << std::endl << p << std::endl;
+                return -1;
+            }
+        }
+    }
+
+
+    // an odd permutation of the edges, which has the rank of the solved pyramid, and a single flipped edge
+    for(const std::string &s: invalidPyramids)
+    {
+        std::list<Operation> moves = {OP_NOOP};
+
+        if(table.solve(pyramid(s), moves) || moves.size() != 1)
+        {
+            std::cout << "The distance table solved the invalid pyramid " << s << " or changed the moves." << std::endl;
+            return -1;
+        }
+    }
+
+    // a saved table must load with the same entries
+    const std::string filename = "/tmp/pyraminx-test-" + std::to_string(getpid()) + ".bin";
+    table.save(filename);
+
+    const DistanceTable loaded(filename);
+    ::unlink(filename.c_str());
+
+    if(loaded.maxDistance() != table.maxDistance())
+    {
+        std::cout << "The loaded distance table has the largest distance " << loaded.maxDistance() << "." << std::endl;
+        return -1;
+    }
+
+    for(size_t r=0; r<PYRAMID_STATES; r++)
+    {
+        if(loaded.get(r) != table.get(r))
+        {
+            std::cout << "The loaded distance table differs at rank " << r << "." << std::endl;
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+int runStateSpaceTest()
+{
+    size_t total = 0;
+    const StateSpace space(4, [&total](int, size_t count){ total += count; });
+
+    if(space.size() != PYRAMID_STATES || total != space.size() || space.maxDepth() != sharedDistanceTable().maxDistance())
+    {
+        std::cout << "The state space has " << space.size() << " pyramids up to depth " << space.maxDepth() << "." << std::endl;
+        return -1;
+    }
+
+    for(size_t r=0; r<PYRAMID_STATES; r++)
+    {
+        if(!space.contains(r))
+        {
+            std::cout << "The state space does not contain rank " << r << "." << std::endl;
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+int runImplicitGraphTest()
+{
+    const ImplicitGraph g;
+
+    for(size_t r=0; r<g.size(); r+=97)
+    {
+        const pyramid p = pyramid::unrank(r);
+        auto edges = g.neighbors(r);
+        int i = 0;
+
+        for(Operation op: solvingMoves)
+        {
+            pyramid pp(p);
+            executeOperation(pp, op);
+
+            if(edgeOperation(edges[i]) != op || edgeTarget(edges[i]) != pp.rank())
+            {
+                std::cout << "Edge " << i << " of node " << r << " of the implicit graph is wrong." << std::endl;
+                return -1;
+            }
+
+            i++;
+        }
+    }
+
+    // searches on the graph find the solution of a valid pyramid, but reject the ones that share a node with a valid one
+    SolverContext ctx(g.size());
+    std::list<Operation> moves;
+
+    if(!solveOnGraph(ctx, g, pyramid(testCases.front().first.back()), moves) || moves.empty())
+    {
+        std::cout << "The search on the implicit graph did not solve " << testCases.front().first.back() << "." << std::endl;
+        return -1;
+    }
+
+    for(const std::string &s: invalidPyramids)
+    {
+        moves = {OP_NOOP};
+
+        if(solveOnGraph(ctx, g, pyramid(s), moves) || moves.size() != 1)
+        {
+            std::cout << "The search on the implicit graph solved the invalid pyramid " << s << " or changed the moves." << std::endl;
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+int runPyramidGraphTest()
+{
+    std::vector<pyramid> nodes;
+    nodes.reserve(PYRAMID_STATES);
+
+    for(size_t r=0; r<PYRAMID_STATES; r++)
+        nodes.push_back(pyramid::unrank(r));
+
+    const ImplicitGraph implicit;
+    const PyramidGraph single(nodes, 1);
+    const PyramidGraph parallel(nodes, 7);
+
+    if(single.size() != implicit.size() || parallel.size() != implicit.size())
+    {
+        std::cout << "The pyramid graphs have " << single.size() << " and " << parallel.size() << " nodes." << std::endl;
+        return -1;
+    }
+
+    for(size_t id=0; id<implicit.size(); id++)
+    {
+        const auto expected = implicit.neighbors(id);
+
+        for(int i=0; i<PyramidGraph::DEGREE; i++)
+        {
+            if(single.neighbors(id)[i] != expected[i] || parallel.neighbors(id)[i] != expected[i])
+            {
+                std::cout << "Edge " << i << " of node " << id << " of the pyramid graph is wrong." << std::endl;
+                return -1;
+            }
+        }
+    }
+
+    // the builder relies on the nodes being in the order of their rank
+    std::swap(nodes[1], nodes[2]);
+
+    try
+    {
+        const PyramidGraph unordered(nodes, 7);
+        std::cout << "The pyramid graph accepted nodes that are not in the order of their rank." << std::endl;
+        return -1;
+    }
+    catch(const std::runtime_error &)
+    {
+    }
+
+    // a truncated edge table is a valid table file, but its edges lead past its nodes
+    const std::string filename = "/tmp/pyraminx-test-" + std::to_string(getpid()) + ".bin";
+    writeTable(filename, TABLE_EDGES, single.neighbors(0), sizeof(EdgeRecord), 1000);
+
+    try
+    {
+        const PyramidGraph truncated(filename);
+        ::unlink(filename.c_str());
+        std::cout << "The pyramid graph loaded edges to nodes that are not in the file." << std::endl;
+        return -1;
+    }
+    catch(const std::runtime_error &)
+    {
+        ::unlink(filename.c_str());
+    }
+
+    return 1;
+}
+
+int runOperationIdentityTest()
+{
+    // operation, and an equivalent sequence of operations
+    const std::list<std::pair<Operation, std::list<Operation>>> identities = {
+        {OP_LEFT_UP, {OP_TURN_RIGHT, OP_RIGHT_DOWN, OP_TURN_LEFT}},
+        {OP_LEFT_DOWN, {OP_TURN_RIGHT, OP_RIGHT_UP, OP_TURN_LEFT}},
+        {OP_BACK_CLOCKWISE, {OP_TURN_LEFT, OP_RIGHT_DOWN, OP_TURN_RIGHT}},
+        {OP_BACK_COUNTER_CLOCKWISE, {OP_TURN_LEFT, OP_RIGHT_UP, OP_TURN_RIGHT}},
+        {OP_LEFT_CORNER_DOWN, {OP_LEFT_CORNER_UP, OP_LEFT_CORNER_UP}},
+        {OP_LEFTEST_UP, {OP_TURN_RIGHT, OP_RIGHTEST_DOWN, OP_TURN_LEFT}},
+        {OP_BACKEST_CLOCKWISE, {OP_TURN_LEFT, OP_RIGHTEST_DOWN, OP_TURN_RIGHT}}
+    };
+
+    for(size_t r=0; r<PYRAMID_STATES; r+=9973)
+    {
+        const pyramid p = pyramid::unrank(r);
+
+        for(Operation op: allOperations)
+        {
+            pyramid pp(p);
+            executeOperation(pp, op);
+            executeOperation(pp, reverseOp(op));
+
+            if(!pp.equal(p))
+            {
+                std::cout << "Operation " << op << " is not undone by its reverse on " << p.storageString() << std::endl;
+                return -1;
+            }
+        }
+
+        for(auto &[op, sequence]: identities)
+        {
+            pyramid p1(p);
+            pyramid p2(p);
+
+            executeOperation(p1, op);
+
+            for(Operation o: sequence)
+                executeOperation(p2, o);
+
+            if(!p1.equal(p2))
+            {
+                std::cout << "Operation " << op << " does not match its definition on " << p.storageString() << std::endl;
+                return -1;
+            }
+        }
+    }
+
+    return 1;
+}
+
+int runMacroOperationTest()
+{
+    static_assert(sequencePermutation<OP_UPPER_RIGHT, OP_UPPER_RIGHT, OP_UPPER_RIGHT>() == FaceletPermutation::identity());
+    static_assert(sequencePermutation<OP_RIGHT_UP, OP_RIGHT_DOWN>() == FaceletPermutation::identity());
+
+    const std::vector<Operation> operations(allOperations.begin(), allOperations.end());
+    uint32_t random = 12345;
+
+    for(size_t r=0; r<PYRAMID_STATES; r+=7919)
+    {
+        pyramid p = pyramid::unrank(r);
+        p.rotateBackestClockwise();
+
+        pyramid fused(p);
+        apply<OP_RIGHT_UP, OP_UPPER_LEFT, OP_BACK_CLOCKWISE, OP_TOP_RIGHT>(fused);
+
+        pyramid single(p);
+
+        for(Operation op: {OP_RIGHT_UP, OP_UPPER_LEFT, OP_BACK_CLOCKWISE, OP_TOP_RIGHT})
+            executeOperation(single, op);
+
+        if(!fused.equal(single))
+        {
+            std::cout << "apply<...>() differs from the single operations on " << p.storageString() << std::endl;
+            return -1;
+        }
+
+        // random sequences of all lengths up to 40, including the empty one
+        std::list<Operation> sequence;
+
+        for(size_t length=r % 41; sequence.size()<length; )
+        {
+            random = random * 1103515245 + 12345;
+            sequence.push_back(operations[(random >> 16) % operations.size()]);
+        }
+
+        fused = p;
+        MacroOperation(sequence).apply(fused);
+
+        single = p;
+
+        for(Operation op: sequence)
+            executeOperation(single, op);
+
+        if(!fused.equal(single))
+        {
+            std::cout << "MacroOperation differs from the single operations on " << p.storageString() << std::endl;
+            return -1;
+        }
+    }
+
+    try
+    {
+        MacroOperation({OP_RIGHT_UP, Operation(OPERATION_COUNT)});
+        std::cout << "MacroOperation accepted an unknown operation." << std::endl;
+        return -1;
+    }
+    catch(const std::runtime_error &)
+    {
+    }
+
+    return 1;
+}
+
+int runCanonicalTest()
+{
+    const std::list<Operation> rotations = {OP_TURN_LEFT, OP_TURN_RIGHT, OP_RIGHT_CORNER_UP, OP_RIGHT_CORNER_DOWN, OP_LEFT_CORNER_UP};
+
+    // the latter two have broken centers, whose colors cannot be told from the tiles around them
+    std::list<pyramid> pyramids = {pyramid("r9,g9,b9,y9"), pyramid("y3r3g3,b9,g9,y9"), pyramid("y9,y9,y9,b9")};
+
+    for(size_t r=0; r<PYRAMID_STATES; r+=7919)
+        pyramids.push_back(pyramid::unrank(r));
+
+    for(const pyramid &p: pyramids)
+    {
+        const CanonicalPyramid key(p);
+
+        if(!key.toPyramid().equal(p.canonical()) || !p.canonical().canonical().equal(p.canonical()))
+        {
+            std::cout << "The canonical form of " << p.storageString() << " is not stable." << std::endl;
+            return -1;
+        }
+
+        pyramid q(p);
+
+        for(int i=0; i<20; i++)
+        {
+            // walk through the orientations in an irregular order
+            auto it = rotations.begin();
+            std::advance(it, (i * 7) % rotations.size());
+            executeOperation(q, *it);
+
+            if(!(CanonicalPyramid(q) == key) || !(q == p))
+            {
+                std::cout << "The rotation " << q.storageString() << " of " << p.storageString() << " has another canonical form." << std::endl;
+                return -1;
+            }
+        }
+
+        executeOperation(q, OP_RIGHT_UP);
+
+        if(CanonicalPyramid(q) == key || q == p)
+        {
+            std::cout << "A move of " << p.storageString() << " has the same canonical form." << std::endl;
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+int runSolveTest()
+{
+    const DistanceTable &table = sharedDistanceTable();
+
+    for(size_t r=1; r<PYRAMID_STATES; r+=46649)
+    {
+        for(SolveMode mode: {SOLVE_BFS, SOLVE_BIDIRECTIONAL, SOLVE_IDA_STAR})
+        {
+            pyramid p = pyramid::unrank(r);
+            std::list<Operation> moves;
+            std::list<Operation> optimal;
+
+            // twist two of the tips as well
+            p.rotateTopLeft();
+            p.rotateLeftestUp();
+
+            if(!solve(p, moves, mode) || !table.solve(p, optimal) || moves.size() != optimal.size())
+            {
+                std::cout << "solve() in mode " << mode << " did not find an optimal solution for " << p.storageString() << std::endl;
+                return -1;
+            }
+
+            for(Operation op: moves)
+                executeOperation(p, op);
+
+            if(!p.isSolved())
+            {
+                std::cout << "The solution of solve() in mode " << mode << " for rank " << r << " does not solve it:" << std::endl << p << std::endl;
+                return -1;
+            }
+        }
+    }
+
+    // the centers of this one do not show the four colors, so there is no solved pyramid in its colors to search towards
+    for(SolveMode mode: {SOLVE_BFS, SOLVE_BIDIRECTIONAL, SOLVE_IDA_STAR})
+    {
+        pyramid p("ybyyyyyyy,y9,y9,b9");
+        std::list<Operation> moves = {OP_NOOP};
+
+        if(solve(p, moves, mode) || moves.size() != 1)
+        {
+            std::cout << "solve() in mode " << mode << " did not reject a pyramid with broken centers." << std::endl;
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+int runBatchTest()
+{
+    const DistanceTable &table = sharedDistanceTable();
+
+    std::vector<std::string> lines;
+
+    for(auto &testpair: testCases)
+        lines.insert(lines.end(), testpair.first.begin(), testpair.first.end());
+
+    lines.insert(lines.begin() + 3, "not a pyramid");
+
+    std::stringstream in;
+    std::stringstream out;
+
+    for(const std::string &line: lines)
+        in << line << "\n\n";
+
+    size_t solved = solveBatch(in, out, [&table](const pyramid &p, std::list<Operation> &moves){ return table.solve(p, moves); }, 3, 2);
+
+    if(solved != lines.size() - 1)
+    {
+        std::cout << "solveBatch() solved " << solved << " of " << lines.size() - 1 << " pyramids." << std::endl;
+        return -1;
+    }
+
+    std::string result;
+    size_t id = 0;
+
+    while(std::getline(out, result))
+    {
+        id++;
+        size_t tab = result.find('\t');
+
+        if(tab == std::string::npos || std::stoul(result.substr(0, tab)) != id || id > lines.size())
+        {
+            std::cout << "solveBatch() wrote the line " << result << " out of order." << std::endl;
+            return -1;
+        }
+
+        std::stringstream moves(result.substr(tab + 1));
+
+        if(id == 4)
+        {
+            if(result.find("error") == std::string::npos)
+            {
+                std::cout << "solveBatch() did not report the invalid line." << std::endl;
+                return -1;
+            }
+
+            continue;
+        }
+
+        pyramid p(lines.at(id - 1));
+        int op;
+
+        while(moves >> op)
+            executeOperation(p, Operation(op));
+
+        if(!p.isSolved())
+        {
+            std::cout << "solveBatch() did not solve " << lines.at(id - 1) << std::endl;
+            return -1;
+        }
+    }
+
+    if(id != lines.size())
+    {
+        std::cout << "solveBatch() wrote " << id << " of " << lines.size() << " lines." << std::endl;
+        return -1;
+    }
+
+    return 1;
+}
+
+int runServiceTest()
+{
+    const DistanceTable &table = sharedDistanceTable();
+    const std::string path = "/tmp/pyraminx-test-" + std::to_string(getpid()) + ".sock";
+
+    SolverService service(path, [&table](const pyramid &p, std::list<Operation> &moves){ return table.solve(p, moves); });
+    std::thread server(&SolverService::run, &service);
+
+    int status = 1;
+
+    try
+    {
+        SolverClient first(path);
+        SolverClient second(path);
+
+        // send all requests before reading any response
+        for(auto &testpair: testCases)
+        {
+            for(auto &s: testpair.first)
+                first.send(s);
+        }
+
+        second.send("not a pyramid");
+        first.send("not a pyramid");
+
+        for(auto &testpair: testCases)
+        {
+            for(auto &s: testpair.first)
+            {
+                std::list<Operation> moves;
+                std::string error;
+                pyramid p(s);
+
+                if(first.receive(moves, error))
+                {
+                    for(Operation op: moves)
+                        executeOperation(p, op);
+                }
+
+                if(!p.isSolved())
+                {
+                    std::cout << "The solver service did not solve " << s << " " << error << std::endl;
+                    status = -1;
+                }
+            }
+        }
+
+        std::list<Operation> moves;
+        std::string error;
+
+        if(first.receive(moves, error) || second.receive(moves, error) || error.empty())
+        {
+            std::cout << "The solver service did not report an invalid pyramid." << std::endl;
+            status = -1;
+        }
+
+        // far more requests than the socket buffers hold, so the service has to send responses while it still reads requests
+        SolverClient third(path);
+        const int pipelined = 20000;
+
+        for(int i=0; i<pipelined; i++)
+            third.send(pyramid::unrank(i * 37 % PYRAMID_STATES).storageString());
+
+        for(int i=0; i<pipelined; i++)
+        {
+            std::list<Operation> moves;
+            pyramid p = pyramid::unrank(i * 37 % PYRAMID_STATES);
+
+            if(!third.receive(moves, error) || !isSolution(p, moves))
+            {
+                std::cout << "The solver service did not solve pipelined request " << i << " " << error << std::endl;
+                status = -1;
+                break;
+            }
+        }
+    }
+    catch(const std::exception &e)
+    {
+        std::cout << e.what() << std::endl;
+        status = -1;
+    }
+
+    service.stop();
+    server.join();
+
+    // a mistyped socket path must not delete a file that is no socket
+    const std::string filename = "/tmp/pyraminx-test-" + std::to_string(getpid()) + ".txt";
+    std::ofstream(filename) << "keep me";
+
+    try
+    {
+        SolverService misplaced(filename, [&table](const pyramid &p, std::list<Operation> &moves){ return table.solve(p, moves); });
+        std::cout << "The solver service listened on a regular file." << std::endl;
+        status = -1;
+    }
+    catch(const std::runtime_error &)
+    {
+    }
+
+    if(::access(filename.c_str(), F_OK) != 0)
+    {
+        std::cout << "The solver service removed a regular file." << std::endl;
+        status = -1;
+    }
+
+    ::unlink(filename.c_str());
+
+    return status;
+}
+
+int runParserTest()
+{
+    std::string buffer;
+
+    for(size_t r=0; r<PYRAMID_STATES; r+=4999)
+    {
+        const pyramid p = pyramid::unrank(r);
+        pyramid q(RED, RED, RED, RED);
+
+        if(parsePyramid(p.storageString(), q) != PARSE_OK || !q.equal(p))
+        {
+            std::cout << "parsePyramid() did not read back " << p.storageString() << std::endl;
+            return -1;
+        }
+
+        buffer += p.storageString() + "\r\n\n";
+    }
+
+    const std::list<std::pair<std::string, ParseError>> malformed = {
+        {"b9,g9,y9", PARSE_SURFACE_COUNT},
+        {"b9,g9,y9,r9,", PARSE_SURFACE_COUNT},
+        {"b9,g9,y9,r9,b9", PARSE_SURFACE_COUNT},
+        {"", PARSE_SURFACE_COUNT},
+        {"b9,9g,y9,r9", PARSE_LEADING_COUNT},
+        {"b9,g9,y9,r9r", PARSE_TOO_MANY_TILES},
+        {"b5b5,g9,y9,r9", PARSE_TOO_MANY_TILES},
+        {"b9,g8,y9,r9", PARSE_TOO_FEW_TILES},
+        {"b9,g9,,r9", PARSE_TOO_FEW_TILES},
+        {"b9,g9,y9,x9", PARSE_ILLEGAL_CHARACTER}
+    };
+
+    for(auto &[s, error]: malformed)
+    {
+        pyramid p(RED, RED, RED, RED);
+
+        if(parsePyramid(s, p) != error || !p.equal(pyramid(RED, RED, RED, RED)))
+        {
+            std::cout << "parsePyramid() did not report " << parseErrorToString(error) << " for " << s << std::endl;
+            return -1;
+        }
+    }
+
+    buffer += "b9,g9,y9\nrg3y3rr,b9,g9,y9";
+
+    std::vector<pyramid> ps;
+    std::vector<ParseError> errors;
+
+    size_t parsed = parsePyramids(buffer, ps, errors);
+
+    if(parsed != ps.size() - 1 || errors.size() != ps.size() || errors.at(errors.size() - 2) != PARSE_SURFACE_COUNT)
+    {
+        std::cout << "parsePyramids() parsed " << parsed << " of " << ps.size() << " lines." << std::endl;
+        return -1;
+    }
+
+    return 1;
+}
+
+int runCoordinateTest()
+{
+    const CoordinateMoves &moves = CoordinateMoves::shared();
+
+    for(size_t r=0; r<PYRAMID_STATES; r+=1999)
+    {
+        pyramid p = pyramid::unrank(r);
+
+        // give every tip a different twist, depending on r
+        for(int c=0; c<4; c++)
+        {
+            for(size_t t=0; t<(r >> c) % 3; t++)
+                executeOperation(p, tipMoves[c]);
+        }
+
+        const CoordinatePyramid c(p);
+
+        if(c.rank() != r || c.tips != p.tipTwists() || !c.toPyramid().equal(p))
+        {
+            std::cout << "The coordinates of " << p.storageString() << " do not convert back." << std::endl;
+            return -1;
+        }
+
+        for(Operation op: allOperations)
+        {
+            pyramid pp(p);
+            executeOperation(pp, op);
+
+            if(!(moves.apply(c, op) == CoordinatePyramid(pp)))
+            {
+                std::cout << "Operation " << op << " on the coordinates of " << p.storageString() << " is wrong." << std::endl;
+                return -1;
+            }
+        }
+    }
+
+    return 1;
+}
+
+int runPyramidBatchTest()
+{
+    // an odd number, so that the padding of the batch is used
+    std::vector<pyramid> ps;
+
+    for(size_t r=0; r<PYRAMID_STATES; r+=9013)
+    {
+        ps.push_back(pyramid::unrank(r));
+        ps.back().rotateTopLeft();
+    }
+
+    for(int kernel=PyramidBatch::KERNEL_SCALAR; kernel<=PyramidBatch::bestKernel(); kernel++)
+    {
+        for(Operation op: allOperations)
+        {
+            PyramidBatch batch;
+
+            for(const pyramid &p: ps)
+                batch.push_back(p);
+
+            batch.apply(op, PyramidBatch::Kernel(kernel));
+
+            for(size_t i=0; i<ps.size(); i++)
+            {
+                pyramid p(ps[i]);
+                executeOperation(p, op);
+
+                if(!batch.at(i).equal(p))
+                {
+                    std::cout << "Kernel " << kernel << " of PyramidBatch is wrong for operation " << op << "." << std::endl;
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+int runSurfaceKernelTest()
+{
+    surface s(RED);
+
+    for(int i=0; i<9; i++)
+        s.setColor(i, i % 4);
+
+    for(int kernel=SURFACE_KERNEL_PORTABLE; kernel<SURFACE_KERNEL_COUNT; kernel++)
+    {
+        if(!surfaceKernelSupported(SurfaceKernel(kernel)))
+            continue;
+
+        if(!checkSurfaceKernel(SurfaceKernel(kernel), true) || !selectSurfaceKernel(SurfaceKernel(kernel)))
+        {
+            std::cout << "Surface kernel " << kernel << " differs from the portable one." << std::endl;
+            selectSurfaceKernel(SURFACE_KERNEL_PORTABLE);
+            return -1;
+        }
+
+        // rotating three times in either direction, or one way and back, gives the same surface
+        for(int rotation=0; rotation<4; rotation++)
+        {
+            surface t(s);
+
+            for(int i=0; i<3; i++)
+            {
+                switch(rotation)
+                {
+                    case 0: t.rotateClockwise(); break;
+                    case 1: t.rotateUpper(); break;
+                    case 2: t.rotateLeft(); break;
+                    case 3: t.rotateRight(); break;
+                }
+            }
+
+            if(!t.equal(s))
+            {
+                std::cout << "Rotation " << rotation << " of the surface has no order of three with kernel " << kernel << "." << std::endl;
+                selectSurfaceKernel(SURFACE_KERNEL_PORTABLE);
+                return -1;
+            }
+        }
+
+        surface t(s);
+        t.rotateClockwise();
+        t.rotateCounterClockwise();
+        t.rotateUpper(false);
+        t.rotateUpper(true);
+        t.rotateLeft(false);
+        t.rotateLeft(true);
+        t.rotateRight(false);
+        t.rotateRight(true);
+
+        if(!t.equal(s) || activeSurfaceKernel() != kernel)
+        {
+            std::cout << "The counter-clockwise rotations of the surface do not undo the clockwise ones with kernel " << kernel << "." << std::endl;
+            selectSurfaceKernel(SURFACE_KERNEL_PORTABLE);
+            return -1;
+        }
+    }
+
+    selectSurfaceKernel(SURFACE_KERNEL_PORTABLE);
+
+    return 1;
+}
@@ -12,3 +12,74 @@ void runAllTests();
 /// i.e. operation(i) on pyramid(i) = pyramid(i+1)
 /// return value: status of the test. -1 if failed, 0 if skipped, 1 if succeeded.
 int runTestCase(const std::list<pyramid> &pyramids, const std::list<Operation> &operations);
+
+/// check that pyramid::rank() and pyramid::unrank() are inverse to each other on all states,
+/// and that the neighbors of every state have a valid rank.
+/// return value: status of the test, as above.
+int runRankingTest();
+
+/// check that parsePyramid() reads back every storageString(), and reports the right error for malformed encodings.
+/// return value: status of the test, as above.
+int runParserTest();
+
+/// check that CoordinatePyramid converts to and from pyramid, and that its table-driven moves agree with the facelet model.
+/// return value: status of the test, as above.
+int runCoordinateTest();
+
+/// check that every kernel of PyramidBatch that this processor supports agrees with executeOperation() for every operation.
+/// return value: status of the test, as above.
+int runPyramidBatchTest();
+
+/// check that every surface kernel that this processor supports agrees with the portable one on all bitfields,
+/// and that the surface rotations work with each of them selected.
+/// return value: status of the test, as above.
+int runSurfaceKernelTest();
+
+/// check that the solutions found with a DistanceTable solve the pyramids including their tips,
+/// with no more layer moves than the largest distance, and that a saved table loads with the same entries.
+/// return value: status of the test, as above.
+int runDistanceTableTest();
+
+/// check that the parallel generation of the state space reaches every rank, in as many layers as the DistanceTable has.
+/// return value: status of the test, as above.
+int runStateSpaceTest();
+
+/// check that the edges of an ImplicitGraph are the moves of solvingMoves, and lead to the ranks of the moved pyramids,
+/// and that searches on it solve valid pyramids but reject invalid ones.
+/// return value: status of the test, as above.
+int runImplicitGraphTest();
+
+/// check that a PyramidGraph built on one thread and on several has the same edges as the ImplicitGraph, edge for edge,
+/// that the builder rejects nodes that are not in the order of their rank, and that loading rejects a truncated edge table.
+/// return value: status of the test, as above.
+int runPyramidGraphTest();
+
+/// check that every operation is undone by its reverse, and that the layer moves that have no test case
+/// agree with their definition by whole turns and other layer moves.
+/// return value: status of the test, as above.
+int runOperationIdentityTest();
+
+/// check that operation sequences fused at compile time with apply<...>() and at runtime with MacroOperation
+/// do the same as executing their operations one after the other.
+/// return value: status of the test, as above.
+int runMacroOperationTest();
+
+/// check that all whole rotations of a pyramid have the same canonical form and key, and that different pyramids do not.
+/// return value: status of the test, as above.
+int runCanonicalTest();
+
+/// check that solve() finds solutions of whole pyramids, tips included, in every mode,
+/// of the same (optimal) length as the DistanceTable, and rejects a pyramid with broken centers.
+/// return value: status of the test, as above.
+int runSolveTest();
+
+/// check that solveBatch() writes a solution for every valid line and an error for every invalid one, in the order of the input,
+/// even with fewer lines in flight than threads.
+/// return value: status of the test, as above.
+int runBatchTest();
+
+/// check that a SolverService answers pipelined requests of two clients in order, and reports invalid pyramids,
+/// also when a client sends more requests than the socket buffers hold before it reads any response,
+/// and that it does not replace a regular file at its socket path.
+/// return value: status of the test, as above.
+int runServiceTest();
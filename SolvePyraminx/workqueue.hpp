@@ -0,0 +1,69 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+/**
+ * A queue between threads that holds at most a fixed number of elements. push() blocks while it is full,
+ * so a fast producer is held back by slow consumers instead of filling the memory.
+ */
+template<class T>
+class WorkQueue
+{
+    public:
+
+    explicit WorkQueue(size_t capacity) : capacity(capacity), closed(false)
+    {
+
+    }
+
+    /// appends x, and waits for room first if the queue is full
+    void push(T x)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this]{ return elements.size() < capacity; });
+
+        elements.push_back(std::move(x));
+        notEmpty.notify_one();
+    }
+
+    /// takes the first element into x, waiting for one if necessary. Returns false if the queue is closed and empty.
+    bool pop(T &x)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this]{ return !elements.empty() || closed; });
+
+        if(elements.empty())
+            return false;
+
+        x = std::move(elements.front());
+        elements.pop_front();
+        notFull.notify_one();
+
+        return true;
+    }
+
+    /// no more elements will be pushed: the consumers finish with the ones left
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+    private:
+
+    std::deque<T> elements;
+
+    const size_t capacity;
+
+    bool closed;
+
+    std::mutex mutex;
+
+    std::condition_variable notEmpty;
+
+    std::condition_variable notFull;
+};